@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//Stereo reverb with the topology and tuning of DaisySP's ReverbSc (Sean
+//Costello's reverbsc): eight delay lines with slowly drifting lengths, each
+//fed by the junction of all of them and sent back through a gain and a one
+//pole lowpass.
+//ReverbSc goes around the eight lines once per sample. Here every line is
+//longer than a block, so nothing written during a block can be read back in
+//the same block: a block is processed by reading each line in turn
+//(contiguous reads), running the gains and lowpasses of all the lines side by
+//side with the junction, and writing each line back (contiguous writes).
+//The one sample Process is kept for the modes that feed the reverb back into
+//themselves sample by sample.
+class BlockReverb {
+    static const int kNumLines = 8;
+    //internal block, longer ones are split
+    static const size_t kBlockSize = 64;
+    //all the lines at 48 kHz (39511 samples)
+    static const size_t kMaxSize = 40000;
+    //the read fractions are in 4.28 fixed point as in ReverbSc, so that the
+    //increments add up over a whole segment without drifting
+    static const int kFracBits = 28;
+    static const int32_t kFracOne = 1 << kFracBits;
+
+    struct Line {
+        float *buffer;
+        int size;
+        int write_pos;
+        //the read position moves in straight segments between random delays
+        int read_pos;
+        int32_t read_frac, read_increment;
+        int segment_remaining;
+        int32_t seed;
+        //output of the lowpass
+        float state;
+    };
+
+    Line lines[kNumLines];
+    float sample_rate;
+    float feedback, target_feedback;
+    float lp_freq, damp_lp_freq, damp;
+
+    float line_out[kNumLines][kBlockSize];
+    //one more than a block, the last one is worked out but not used
+    float junction[kBlockSize + 1];
+    float memory[kMaxSize];
+
+    //ReverbSc's table: length (in samples at 29761 Hz), modulation depth (s),
+    //modulation rate (Hz), random seed
+    static float LineParameter(int n, int p) {
+        static const float parameters[kNumLines][4] = {
+            {2473.f / 29761.f, 0.0010f, 3.100f, 1966.f},
+            {2767.f / 29761.f, 0.0011f, 3.500f, 29491.f},
+            {3217.f / 29761.f, 0.0017f, 1.110f, 22937.f},
+            {3557.f / 29761.f, 0.0006f, 3.973f, 9830.f},
+            {3907.f / 29761.f, 0.0010f, 2.341f, 20643.f},
+            {4127.f / 29761.f, 0.0011f, 1.897f, 22937.f},
+            {2143.f / 29761.f, 0.0017f, 0.891f, 29491.f},
+            {1933.f / 29761.f, 0.0006f, 3.221f, 14417.f},
+        };
+        return parameters[n][p];
+    };
+
+    float RandomDelay(int n, int32_t seed) {
+        return (LineParameter(n, 0) + seed / 32768.f * LineParameter(n, 1)) * sample_rate;
+    };
+
+    //write_pos is where the line is written next
+    void NextSegment(Line &line, int n, int write_pos) {
+        //16 bit signed LCG
+        line.seed = ((line.seed & 0xFFFF) * 15625 + 1) & 0xFFFF;
+        if (line.seed >= 0x8000) {
+            line.seed -= 0x10000;
+        }
+        line.segment_remaining = static_cast<int>(sample_rate / LineParameter(n, 2) + 0.5f);
+        float delay = write_pos - (line.read_pos + line.read_frac * (1.f / kFracOne));
+        if (delay < 0.f) {
+            delay += line.size;
+        }
+        //one sample, plus the change of delay spread over the segment
+        float change = (delay - RandomDelay(n, line.seed)) / line.segment_remaining;
+        line.read_increment = kFracOne + static_cast<int32_t>(lrintf(change * kFracOne));
+    };
+
+    static inline void Advance(Line &line, int count) {
+        int64_t frac = line.read_frac + static_cast<int64_t>(line.read_increment) * count;
+        line.read_pos += static_cast<int>(frac >> kFracBits);
+        line.read_frac = static_cast<int32_t>(frac & (kFracOne - 1));
+        if (line.read_pos >= line.size) {
+            line.read_pos -= line.size;
+        }
+    };
+
+    //4 points lagrange, as ReverbSc
+    static inline float Interpolate(float xm1, float x0, float x1, float x2, float t) {
+        float a = (x2 - xm1) * (1.f / 6.f) + (x0 - x1) * 0.5f;
+        float b = (xm1 + x1) * 0.5f - x0;
+        float c = x1 - x0 * 0.5f - xm1 * (1.f / 3.f) - x2 * (1.f / 6.f);
+        return ((a * t + b) * t + c) * t + x0;
+    };
+
+    static inline float Read(const float *buffer, int size, int index, float t) {
+        if (index >= 1 && index + 2 < size) {
+            const float *x = &buffer[index];
+            return Interpolate(x[-1], x[0], x[1], x[2], t);
+        }
+        float xm1 = buffer[index == 0 ? size - 1 : index - 1];
+        float x0 = buffer[index];
+        float x1 = buffer[index + 1 < size ? index + 1 : index + 1 - size];
+        float x2 = buffer[index + 2 < size ? index + 2 : index + 2 - size];
+        return Interpolate(xm1, x0, x1, x2, t);
+    };
+
+    void UpdateDamp() {
+        if (lp_freq != damp_lp_freq) {
+            damp_lp_freq = lp_freq;
+            float b = 2.f - cosf(lp_freq * 2.f * static_cast<float>(M_PI) / sample_rate);
+            damp = b - sqrtf(b * b - 1.f);
+        }
+    };
+
+    void ProcessBlock(const float *in_l, const float *in_r, float *out_l, float *out_r, int size, float feedback_increment) {
+        //reads: only depend on what was written before the block
+        for (int n = 0; n < kNumLines; n++) {
+            Line &line = lines[n];
+            const float *buffer = line.buffer;
+            const int line_size = line.size;
+            float *out = line_out[n];
+            int i = 0;
+            while (i < size) {
+                //the part of the block in the current segment, where the read
+                //position moves by a constant step
+                int run = line.segment_remaining;
+                if (run > size - i) {
+                    run = size - i;
+                }
+                if (line.read_pos >= 1 && line.read_pos + 2 * run + 3 < line_size) {
+                    //most runs don't go across the end of the line, the
+                    //position only has to stay precise over a block there
+                    //so it is stepped in 16.16
+                    int32_t pos = (line.read_pos << 16) | (line.read_frac >> (kFracBits - 16));
+                    int32_t pos_increment = line.read_increment >> (kFracBits - 16);
+                    for (int j = 0; j < run; j++) {
+                        const float *x = &buffer[pos >> 16];
+                        float t = (pos & 0xFFFF) * (1.f / 65536.f);
+                        out[i + j] = Interpolate(x[-1], x[0], x[1], x[2], t);
+                        pos += pos_increment;
+                    }
+                    Advance(line, run);
+                } else {
+                    for (int j = 0; j < run; j++) {
+                        out[i + j] = Read(buffer, line_size, line.read_pos, line.read_frac * (1.f / kFracOne));
+                        Advance(line, 1);
+                    }
+                }
+                i += run;
+                line.segment_remaining -= run;
+                if (line.segment_remaining <= 0) {
+                    //the writes of the block haven't been done yet
+                    int write_pos = line.write_pos + i;
+                    if (write_pos >= line_size) {
+                        write_pos -= line_size;
+                    }
+                    NextSegment(line, n, write_pos);
+                }
+            }
+        }
+
+        //feedback and lowpass, the eight lines side by side so that their
+        //filters don't wait on each other. The junction of sample i is
+        //written with the states of sample i-1.
+        float state[kNumLines];
+        float sum = 0.f;
+        for (int n = 0; n < kNumLines; n++) {
+            state[n] = lines[n].state;
+            sum += state[n];
+        }
+        junction[0] = sum * 0.25f;
+        for (int i = 0; i < size; i++) {
+            float gain = feedback + feedback_increment * (i + 1);
+            for (int n = 0; n < kNumLines; n++) {
+                float value = line_out[n][i] * gain;
+                state[n] = (state[n] - value) * damp + value;
+                line_out[n][i] = state[n];
+            }
+            float even = state[0] + state[2] + state[4] + state[6];
+            float odd = state[1] + state[3] + state[5] + state[7];
+            out_l[i] = even * 0.35f;
+            out_r[i] = odd * 0.35f;
+            junction[i + 1] = (even + odd) * 0.25f;
+        }
+
+        //writes
+        for (int n = 0; n < kNumLines; n++) {
+            Line &line = lines[n];
+            const float *in = n & 1 ? in_r : in_l;
+            const float *out = line_out[n];
+            float *buffer = line.buffer;
+            int write_pos = line.write_pos;
+            const int line_size = line.size;
+            float previous = line.state;
+            for (int i = 0; i < size; i++) {
+                buffer[write_pos] = in[i] + junction[i] - previous;
+                previous = out[i];
+                if (++write_pos >= line_size) {
+                    write_pos = 0;
+                }
+            }
+            line.write_pos = write_pos;
+            line.state = out[size - 1];
+        }
+        feedback += feedback_increment * size;
+    };
+
+    public:
+    BlockReverb() {};
+    ~BlockReverb() {};
+
+    //returns -1 if the lines don't fit at this sample rate
+    int Init(float _sample_rate) {
+        sample_rate = _sample_rate;
+        feedback = target_feedback = 0.97f;
+        lp_freq = 10000.f;
+        damp_lp_freq = 0.f;
+        damp = 0.f;
+
+        size_t offset = 0;
+        for (int n = 0; n < kNumLines; n++) {
+            Line &line = lines[n];
+            line.size = static_cast<int>((LineParameter(n, 0) + LineParameter(n, 1) * 1.125f) * sample_rate + 16.5f);
+            if (offset + line.size > kMaxSize) {
+                return -1;
+            }
+            line.buffer = &memory[offset];
+            offset += line.size;
+            for (int i = 0; i < line.size; i++) {
+                line.buffer[i] = 0.f;
+            }
+            line.write_pos = 0;
+            line.seed = static_cast<int32_t>(LineParameter(n, 3));
+            float read_pos = line.size - RandomDelay(n, line.seed);
+            line.read_pos = static_cast<int>(read_pos);
+            line.read_frac = static_cast<int32_t>((read_pos - line.read_pos) * kFracOne + 0.5f);
+            line.state = 0.f;
+            NextSegment(line, n, 0);
+        }
+        return 0;
+    };
+
+    //the change is ramped over the next Process call
+    void SetFeedback(float _feedback) {
+        target_feedback = _feedback;
+    };
+
+    //only takes effect at the next Process call, so it can be set every sample
+    void SetLpFreq(float freq) {
+        lp_freq = freq;
+    };
+
+    void Process(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size) {
+        UpdateDamp();
+        float feedback_increment = (target_feedback - feedback) / size;
+        while (size > 0) {
+            size_t block = size < kBlockSize ? size : kBlockSize;
+            ProcessBlock(in_l, in_r, out_l, out_r, static_cast<int>(block), feedback_increment);
+            in_l += block;
+            in_r += block;
+            out_l += block;
+            out_r += block;
+            size -= block;
+        }
+        feedback = target_feedback;
+    };
+
+    //the same, one sample at a time
+    void Process(float in_l, float in_r, float *out_l, float *out_r) {
+        UpdateDamp();
+        feedback = target_feedback;
+
+        float sum = 0.f;
+        for (int n = 0; n < kNumLines; n++) {
+            sum += lines[n].state;
+        }
+        sum *= 0.25f;
+
+        float wet_l = 0.f;
+        float wet_r = 0.f;
+        for (int n = 0; n < kNumLines; n++) {
+            Line &line = lines[n];
+            line.buffer[line.write_pos] = (n & 1 ? in_r : in_l) + sum - line.state;
+            if (++line.write_pos >= line.size) {
+                line.write_pos = 0;
+            }
+            float value = Read(line.buffer, line.size, line.read_pos, line.read_frac * (1.f / kFracOne));
+            Advance(line, 1);
+            value *= feedback;
+            line.state = (line.state - value) * damp + value;
+            if (n & 1) {
+                wet_r += line.state;
+            } else {
+                wet_l += line.state;
+            }
+            if (--line.segment_remaining <= 0) {
+                NextSegment(line, n, line.write_pos);
+            }
+        }
+        *out_l = wet_l * 0.35f;
+        *out_r = wet_r * 0.35f;
+    };
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "dsp.h"
+
+enum LoopQuality {
+    LOOP_LINEAR,
+    LOOP_HERMITE,
+    LOOP_SINC,
+    LOOP_QUALITY_LAST
+};
+
+//Where one output sample is read: the loop starts at ring index start (its
+//oldest sample), age is the integral part of the position in it, from 0 to
+//len - 1, fractional the rest
+struct LoopPosition {
+    int start;
+    int age;
+    float fractional;
+};
+
+//Interpolated reads of a loop kept in a record ring of kRingSize samples, a
+//block at a time. The taps wrap on the loop (after the newest sample comes
+//the oldest) and then on the ring. Layers laid out like the loop (index 0 is
+//its oldest sample) can be read with it: their taps are summed with the
+//loop's before the interpolation, so a layer costs the loads of its taps.
+//  LOOP_LINEAR   2 taps
+//  LOOP_HERMITE  4 taps, stmlib's InterpolateHermite
+//  LOOP_SINC     Blackman windowed sinc, kZeroCrossings each side, from a
+//                polyphase bank. Above speed 1 the sinc is stretched (the
+//                banks for speed 2 and 4) so that it also removes what would
+//                alias when the loop is played faster: 8 taps up to speed 1,
+//                16 up to 2, 32 above
+//The taps are read straight from the ring when they don't wrap, which is
+//nearly always; the wraps are masks, with no division or branch per tap.
+template <typename Storage, int kRingSize>
+class LoopReader {
+    typedef typename Storage::Type Type;
+
+    static const int kZeroCrossings = 4;
+    static const int kBanks = 3;
+    //the fractional positions the filters are computed for, the ones in
+    //between are interpolated
+    static const int kPhases = 64;
+    static const int kBankSize = (kPhases + 1) * 2 * kZeroCrossings * ((1 << kBanks) - 1);
+
+    //kPhases + 1 filters per bank, filter p for a position p / kPhases of a
+    //sample after tap taps / 2 - 1. The last one is a whole sample after, so
+    //that every phase has the next one to be interpolated with
+    float filters[kBankSize];
+
+    //x from -size to 2 * size - 1 wrapped into [0, size)
+    static inline int Wrap(int x, int size) {
+        x += size & -static_cast<int>(x < 0);
+        x -= size & -static_cast<int>(x >= size);
+        return x;
+    };
+
+    //count samples of the loop from age first on, first from -len on and
+    //first + count up to 2 * len
+    inline void Gather(const Type *ring, int start, int len, int first, int count, float *x) const {
+        int index = start + first;
+        if (first >= 0 && first + count <= len && index + count <= kRingSize) {
+            const Type *p = ring + index;
+            for (int k = 0; k < count; k++) {
+                x[k] = Storage::Unpack(p[k]);
+            }
+        } else {
+            for (int k = 0; k < count; k++) {
+                x[k] = Storage::Unpack(ring[Wrap(start + Wrap(first + k, len), kRingSize)]);
+            }
+        }
+    };
+
+    //adds the same samples of the layers
+    inline void GatherLayers(const Type *const *layers, int num_layers, int len, int first, int count, float *x) const {
+        if (first >= 0 && first + count <= len) {
+            for (int l = 0; l < num_layers; l++) {
+                const Type *p = layers[l] + first;
+                for (int k = 0; k < count; k++) {
+                    x[k] += Storage::Unpack(p[k]);
+                }
+            }
+        } else {
+            for (int l = 0; l < num_layers; l++) {
+                for (int k = 0; k < count; k++) {
+                    x[k] += Storage::Unpack(layers[l][Wrap(first + k, len)]);
+                }
+            }
+        }
+    };
+
+    //the banks before have 1, 2, ... times the taps of the first
+    static int BankOffset(int bank) {
+        return (kPhases + 1) * 2 * kZeroCrossings * ((1 << bank) - 1);
+    };
+
+    void ReadLinear(const Type *ring, const Type *const *layers, int num_layers, int len, const LoopPosition *positions, float *out, size_t size) const {
+        for (size_t i = 0; i < size; i++) {
+            float x[2];
+            Gather(ring, positions[i].start, len, positions[i].age, 2, x);
+            GatherLayers(layers, num_layers, len, positions[i].age, 2, x);
+            out[i] = x[0] + (x[1] - x[0]) * positions[i].fractional;
+        }
+    };
+
+    void ReadHermite(const Type *ring, const Type *const *layers, int num_layers, int len, const LoopPosition *positions, float *out, size_t size) const {
+        for (size_t i = 0; i < size; i++) {
+            float x[4];
+            Gather(ring, positions[i].start, len, positions[i].age - 1, 4, x);
+            GatherLayers(layers, num_layers, len, positions[i].age - 1, 4, x);
+            out[i] = stmlib::InterpolateHermite(x + 1, positions[i].fractional, 1.f);
+        }
+    };
+
+    template <int kTaps>
+    void ReadSinc(const Type *ring, const Type *const *layers, int num_layers, int len, const LoopPosition *positions, const float *bank, float *out, size_t size) const {
+        for (size_t i = 0; i < size; i++) {
+            //a position before the oldest sample has a negative fractional part
+            int age = positions[i].age;
+            float fractional = positions[i].fractional;
+            int borrow = fractional < 0.f;
+            age -= borrow;
+            fractional += borrow;
+
+            float phase = fractional * kPhases;
+            int32_t phase_integral = static_cast<int32_t>(phase);
+            phase_integral = phase_integral < kPhases ? phase_integral : kPhases - 1;
+            float phase_fractional = phase - static_cast<float>(phase_integral);
+            const float *a = bank + phase_integral * kTaps;
+            const float *b = a + kTaps;
+
+            float x[kTaps];
+            Gather(ring, positions[i].start, len, age - kTaps / 2 + 1, kTaps, x);
+            GatherLayers(layers, num_layers, len, age - kTaps / 2 + 1, kTaps, x);
+            float sum = 0.f;
+            for (int k = 0; k < kTaps; k++) {
+                sum += x[k] * (a[k] + (b[k] - a[k]) * phase_fractional);
+            }
+            out[i] = sum;
+        }
+    };
+
+    public:
+    LoopReader() {};
+    ~LoopReader() {};
+
+    void Init() {
+        for (int bank = 0; bank < kBanks; bank++) {
+            float *filter = filters + BankOffset(bank);
+            int taps = Taps(bank);
+            float cutoff = 1.f / (1 << bank);
+            for (int p = 0; p <= kPhases; p++) {
+                float sum = 0.f;
+                for (int k = 0; k < taps; k++) {
+                    //distance from the position to the tap, in samples
+                    float d = taps / 2 - 1 - k + static_cast<float>(p) / kPhases;
+                    float x = fabsf(d) * cutoff;
+                    float w = 0.f;
+                    if (x < kZeroCrossings) {
+                        float sinc = x == 0.f ? 1.f : sinf(M_PI * x) / (M_PI * x);
+                        float u = x / kZeroCrossings;
+                        w = sinc * (0.42f + 0.5f * cosf(M_PI * u) + 0.08f * cosf(2.f * M_PI * u));
+                    }
+                    filter[p * taps + k] = w;
+                    sum += w;
+                }
+                //each filter adds up to 1, a DC offset in the loop would
+                //ripple with the position otherwise
+                for (int k = 0; k < taps; k++) {
+                    filter[p * taps + k] /= sum;
+                }
+            }
+        }
+    };
+
+    //the bank LOOP_SINC takes at this speed, and its taps: the cost per
+    //sample of a block
+    static int SincBank(float speed) {
+        speed = fabsf(speed);
+        return speed > 2.f ? 2 : (speed > 1.f ? 1 : 0);
+    };
+    static int Taps(int bank) {
+        return 2 * kZeroCrossings << bank;
+    };
+    //taps per sample of a quality at this speed, for the loop and each layer
+    static int Taps(LoopQuality quality, float speed) {
+        return quality == LOOP_SINC ? Taps(SincBank(speed)) : (quality == LOOP_HERMITE ? 4 : 2);
+    };
+
+    //size samples of a loop of len samples and of num_layers layers of the
+    //same length, at the positions given. speed is how fast the positions
+    //move, only the sinc uses it. A loop shorter than the taps is read with
+    //the linear interpolation
+    void Read(const Type *ring, const Type *const *layers, int num_layers, int len, const LoopPosition *positions,
+              float speed, LoopQuality quality, float *out, size_t size) const {
+        if (len <= 0) {
+            for (size_t i = 0; i < size; i++) {
+                out[i] = 0.f;
+            }
+            return;
+        }
+        int bank = SincBank(speed);
+        if (quality == LOOP_SINC && len > Taps(bank)) {
+            switch (bank) {
+                case 0: ReadSinc<2 * kZeroCrossings>(ring, layers, num_layers, len, positions, filters + BankOffset(0), out, size); break;
+                case 1: ReadSinc<4 * kZeroCrossings>(ring, layers, num_layers, len, positions, filters + BankOffset(1), out, size); break;
+                default: ReadSinc<8 * kZeroCrossings>(ring, layers, num_layers, len, positions, filters + BankOffset(2), out, size); break;
+            }
+        } else if (quality >= LOOP_HERMITE && len >= 2) {
+            ReadHermite(ring, layers, num_layers, len, positions, out, size);
+        } else {
+            ReadLinear(ring, layers, num_layers, len, positions, out, size);
+        }
+    };
+};
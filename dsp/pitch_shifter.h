@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//Delay line pitch shifter for the reverb shimmer. Two taps read the ring at
+//delays that sweep between 1 and window samples, half a sweep apart: when a
+//tap jumps back to the other end of the window its gain is zero, so the
+//grains are crossfaded instead of clicking at the wrap.
+//  ratio 2 is an octave up, 0.5 an octave down
+//The ring is a power of two so that every index is a mask, with no division
+//in the audio loop.
+template <size_t kSize>
+class PitchShifter {
+    static_assert((kSize & (kSize - 1)) == 0, "the ring size has to be a power of two");
+    static const size_t kMask = kSize - 1;
+
+    float buffer[kSize];
+    size_t write_pos;
+    //longest delay of a tap, in samples
+    float window;
+    //where the first tap is in its sweep, from 0 to 1
+    float phase, phase_increment;
+
+    //linear interpolation, delay goes from 1 (the last sample written) to
+    //window + 1
+    inline float Tap(float sweep) const {
+        float delay = 1.f + sweep * window;
+        int32_t delay_integral = static_cast<int32_t>(delay);
+        float t = delay - static_cast<float>(delay_integral);
+        int32_t index = static_cast<int32_t>(write_pos) - delay_integral;
+        float a = buffer[index & kMask];
+        float b = buffer[(index - 1) & kMask];
+        return a + (b - a) * t;
+    };
+
+    public:
+    PitchShifter() {};
+    ~PitchShifter() {};
+
+    void Init(float _window) {
+        for (size_t i = 0; i < kSize; i++) {
+            buffer[i] = 0.f;
+        }
+        write_pos = 0;
+        window = _window < kSize - 2 ? _window : kSize - 2;
+        phase = 0.f;
+        SetRatio(1.f);
+    };
+
+    void SetRatio(float ratio) {
+        phase_increment = (1.f - ratio) / window;
+    };
+
+    inline float Process(float in) {
+        buffer[write_pos] = in;
+        write_pos = (write_pos + 1) & kMask;
+
+        phase += phase_increment;
+        if (phase >= 1.f) {
+            phase -= 1.f;
+        } else if (phase < 0.f) {
+            phase += 1.f;
+        }
+        float phase_2 = phase < 0.5f ? phase + 0.5f : phase - 0.5f;
+
+        //triangle, zero where the first tap wraps and one where the second
+        //does, smoothed so the gains stay complementary
+        float gain = 1.f - fabsf(phase * 2.f - 1.f);
+        gain = gain * gain * (3.f - 2.f * gain);
+
+        float a = Tap(phase);
+        float b = Tap(phase_2);
+        return b + (a - b) * gain;
+    };
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+//Formats for audio kept in long buffers, where the memory (and the bandwidth
+//to it) matters more than the precision. Pack() takes a sample in [-1, 1],
+//Unpack() gives it back.
+
+//32 bit float, as it comes
+struct FloatStorage {
+    typedef float Type;
+
+    static inline Type Pack(float x) {
+        return x;
+    };
+    static inline float Unpack(Type s) {
+        return s;
+    };
+};
+
+//16 bit signed, saturated: half the size, 96 dB of range. On the Cortex-M7
+//both ways are a multiply and a conversion, no branch.
+struct S16Storage {
+    typedef int16_t Type;
+
+    static inline Type Pack(float x) {
+        x *= 32768.f;
+        x = x > 32767.f ? 32767.f : x;
+        x = x < -32768.f ? -32768.f : x;
+        return static_cast<Type>(x);
+    };
+    static inline float Unpack(Type s) {
+        return s * (1.f / 32768.f);
+    };
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+//Bump allocator over a fixed pool, for the buffers that only one mode needs.
+//The modes never run together, so the mode that becomes active Reset()s the
+//arena and takes what it needs from the start of the pool: the memory is
+//shared on purpose and a mode only sees its own buffers.
+//Nothing is cleared on its own (the SDRAM isn't cleared at startup either):
+//the owner initializes what it gets, or has Clear() zero it a piece at a
+//time, so that tens of MB never have to be cleared in one go.
+class Arena {
+    //a cache line of the Cortex-M7
+    static const size_t kAlignment = 32;
+
+    uint8_t *pool;
+    size_t size;
+    size_t used;
+    //everything before is zero or was initialized by its owner
+    size_t cleared;
+
+    //offset of the next aligned block
+    size_t Aligned() const {
+        uintptr_t address = reinterpret_cast<uintptr_t>(pool) + used;
+        return used + ((kAlignment - address % kAlignment) % kAlignment);
+    };
+
+    public:
+    Arena() : pool(nullptr), size(0), used(0), cleared(0) {};
+    ~Arena() {};
+
+    void Init(void *_pool, size_t _size) {
+        pool = static_cast<uint8_t *>(_pool);
+        size = _size;
+        used = cleared = 0;
+    };
+
+    //everything that was allocated is given back
+    void Reset() {
+        used = cleared = 0;
+    };
+
+    //count elements, nullptr if they don't fit
+    template <typename T>
+    T *Allocate(size_t count) {
+        static_assert(alignof(T) <= kAlignment, "the arena doesn't align to more than a cache line");
+        size_t offset = Aligned();
+        if (offset > size || count > (size - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        used = offset + count * sizeof(T);
+        return reinterpret_cast<T *>(pool + offset);
+    };
+
+    //an object built with its default constructor, nullptr if it doesn't fit
+    template <typename T>
+    T *Create() {
+        T *object = Allocate<T>(1);
+        return object ? new (object) T : nullptr;
+    };
+
+    //how many elements of T still fit
+    template <typename T>
+    size_t Available() const {
+        size_t offset = Aligned();
+        return offset < size ? (size - offset) / sizeof(T) : 0;
+    };
+
+    size_t Used() const {
+        return used;
+    };
+
+    //gives back what was allocated after mark, a value of Used(): the last
+    //buffers can go without the others
+    void Rewind(size_t mark) {
+        used = mark < used ? mark : used;
+        cleared = cleared < used ? cleared : used;
+    };
+
+    //zeroes up to max_bytes more of what was allocated, true once it is all
+    //cleared
+    bool Clear(size_t max_bytes) {
+        size_t bytes = used - cleared < max_bytes ? used - cleared : max_bytes;
+        memset(pool + cleared, 0, bytes);
+        cleared += bytes;
+        return cleared == used;
+    };
+
+    //what was allocated so far doesn't need clearing
+    void MarkCleared() {
+        cleared = used;
+    };
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+//Everything the effects need from the front panel of the module.
+//The firmware implements it on top of DaisyVersio, the host build on top of
+//plain variables, so none of the DSP code touches the hardware directly.
+class ControlSurface {
+    public:
+    enum Knob {
+        KNOB_0,
+        KNOB_1,
+        KNOB_2,
+        KNOB_3,
+        KNOB_4,
+        KNOB_5,
+        KNOB_6,
+        KNOB_LAST
+    };
+
+    enum Switch {
+        SW_0,
+        SW_1,
+        SW_LAST
+    };
+
+    virtual ~ControlSurface() {};
+
+    //reads the ADCs and runs the knob filtering, called once per control cycle
+    virtual void ProcessAnalogControls() = 0;
+    //knob position in the 0..1 range
+    virtual float GetKnobValue(int idx) = 0;
+    //position of the 3-way switch (0, 1 or 2)
+    virtual int ReadSwitch(int idx) = 0;
+
+    virtual bool TapRisingEdge() = 0;
+    virtual void DebounceTap() = 0;
+    virtual bool GateTrig() = 0;
+
+    virtual void SetLed(size_t idx, float r, float g, float b) = 0;
+    //pushes the colors set with SetLed to the leds
+    virtual void UpdateLeds() = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#ifdef TEST
+#include <chrono>
+#endif
+
+#ifndef TEST
+extern "C" uint32_t SystemCoreClock;
+#endif
+
+//Free running tick counter for the profiler. On the Versio it is the
+//Cortex-M7 DWT cycle counter, on the host (TEST) a nanosecond clock.
+//Only differences are meaningful, the 32 bits wrap after a few seconds.
+class CycleCounter {
+#ifndef TEST
+    //Core debug and DWT registers, see the ARMv7-M reference manual
+    static volatile uint32_t &DEMCR() { return *reinterpret_cast<volatile uint32_t *>(0xE000EDFC); };
+    static volatile uint32_t &DWT_CTRL() { return *reinterpret_cast<volatile uint32_t *>(0xE0001000); };
+    static volatile uint32_t &DWT_CYCCNT() { return *reinterpret_cast<volatile uint32_t *>(0xE0001004); };
+    static volatile uint32_t &DWT_LAR() { return *reinterpret_cast<volatile uint32_t *>(0xE0001FB0); };
+#endif
+
+    public:
+    static void Init() {
+#ifndef TEST
+        DEMCR() |= (1UL << 24);     //TRCENA
+        DWT_LAR() = 0xC5ACCE55;     //the M7 keeps the DWT locked after reset
+        DWT_CYCCNT() = 0;
+        DWT_CTRL() |= 1UL;          //CYCCNTENA
+#endif
+    };
+
+    static inline uint32_t Now() {
+#ifndef TEST
+        return DWT_CYCCNT();
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    };
+
+    static uint32_t TicksPerSecond() {
+#ifndef TEST
+        return SystemCoreClock;
+#else
+        return 1000000000UL;
+#endif
+    };
+};
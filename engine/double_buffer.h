@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+
+//Hands a value from the main loop to the audio interrupt without locks.
+//The writer fills Back() and then Publish() makes it the front copy; the
+//reader takes Front() at the start of each callback.
+//It relies on the reader being an interrupt that runs to completion on the
+//same core (as the audio callback does): the writer can't be running while
+//the reader is halfway through the front copy, so two copies are enough.
+template <typename T>
+class DoubleBuffer {
+    T buffers[2];
+    std::atomic<int> front;
+
+    public:
+    DoubleBuffer() : buffers(), front(0) {};
+    ~DoubleBuffer() {};
+
+    //writer side
+    T *Back() {
+        return &buffers[1 - front.load(std::memory_order_relaxed)];
+    };
+    void Publish() {
+        front.store(1 - front.load(std::memory_order_relaxed), std::memory_order_release);
+    };
+
+    //reader side
+    const T &Front() const {
+        return buffers[front.load(std::memory_order_acquire)];
+    };
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+//Equal power dry/wet crossfade shared by the modes.
+//  wet = level * sqrt(mix)
+//  dry = level * sqrt(dry_level * (2 - 2 * mix))
+//The gains only move with the knobs, so SetMix works them out once per block
+//and Mix ramps linearly to them over the block: mixing a stereo sample is two
+//multiply-adds per channel, with no branches, and no sqrt in the audio loop.
+class DryWetMixer {
+    float level;
+    float dry_level;
+
+    //where the ramps are, they start from silence
+    float wet, dry;
+    float wet_increment, dry_increment;
+
+    public:
+    DryWetMixer() {};
+    ~DryWetMixer() {};
+
+    void Init(float _dry_level, float _level) {
+        dry_level = _dry_level;
+        level = _level;
+        wet = dry = 0.f;
+        wet_increment = dry_increment = 0.f;
+    };
+
+    //mix (0 dry, 1 wet) reached at the end of the next size samples,
+    //Mix has to be called once per sample of the block
+    void SetMix(float mix, size_t size) {
+        float target_wet = level * sqrtf(mix);
+        float target_dry = level * sqrtf(dry_level * (2.f - mix * 2.f));
+        float step = 1.f / static_cast<float>(size);
+        wet_increment = (target_wet - wet) * step;
+        dry_increment = (target_dry - dry) * step;
+    };
+
+    //the outputs can alias the inputs
+    inline void Mix(float dry_l, float dry_r, float wet_l, float wet_r, float &out_l, float &out_r) {
+        wet += wet_increment;
+        dry += dry_increment;
+        out_l = wet * wet_l + dry * dry_l;
+        out_r = wet * wet_r + dry * dry_r;
+    };
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "cycle_counter.h"
+
+struct FftBenchResult {
+    //CycleCounter ticks per transform, the best run: cycles on the Versio,
+    //ns on the host
+    uint32_t ticks;
+    //the largest difference from the reference DFT over the bins, relative
+    //to the largest bin, in dB
+    float error_db;
+};
+
+//Times a real FFT of the layout of real_fft.h and checks its spectrum
+//against a DFT computed in double, on a few sines between the bins and some
+//noise. The DFT takes kSize * kSize steps: on the Versio it is for the
+//startup of a profiler build, not for a callback.
+template <typename Fft, size_t kSize>
+class FftBench {
+    Fft fft;
+    float signal[kSize];
+    float input[kSize];
+    float output[kSize];
+
+    public:
+    FftBench() {};
+    ~FftBench() {};
+
+    void Init() {
+        fft.Init();
+        uint32_t noise = 1;
+        for (size_t n = 0; n < kSize; n++) {
+            noise = noise * 1664525 + 1013904223;
+            float t = static_cast<float>(n) / kSize;
+            signal[n] = 0.5f * sinf(2.f * M_PI * 37.3f * t) + 0.25f * sinf(2.f * M_PI * 101.7f * t + 1.f)
+                        + 0.01f * sinf(2.f * M_PI * 400.2f * t) + 0.001f * (static_cast<float>(noise >> 8) / (1 << 24) - 0.5f);
+        }
+    };
+
+    FftBenchResult Run(int runs) {
+        FftBenchResult result;
+        result.ticks = UINT32_MAX;
+        for (int r = 0; r < runs; r++) {
+            for (size_t n = 0; n < kSize; n++) {
+                input[n] = signal[n];
+            }
+            uint32_t start = CycleCounter::Now();
+            fft.Direct(input, output);
+            uint32_t ticks = CycleCounter::Now() - start;
+            result.ticks = ticks < result.ticks ? ticks : result.ticks;
+        }
+
+        double max_error = 0.0;
+        double max_bin = 0.0;
+        for (size_t k = 0; k <= kSize / 2; k++) {
+            //the twiddle of each sample by rotation, exact enough in double
+            double re = 0.0, im = 0.0;
+            double w_re = cos(2.0 * M_PI * k / kSize), w_im = -sin(2.0 * M_PI * k / kSize);
+            double p_re = 1.0, p_im = 0.0;
+            for (size_t n = 0; n < kSize; n++) {
+                re += signal[n] * p_re;
+                im += signal[n] * p_im;
+                double next_re = p_re * w_re - p_im * w_im;
+                p_im = p_re * w_im + p_im * w_re;
+                p_re = next_re;
+            }
+            double fft_re = output[k];
+            double fft_im = (k == 0 || k == kSize / 2) ? 0.0 : -output[kSize / 2 + k];
+            max_error = fmax(max_error, hypot(fft_re - re, fft_im - im));
+            max_bin = fmax(max_bin, hypot(re, im));
+        }
+        result.error_db = static_cast<float>(20.0 * log10(fmax(max_error, 1e-30) / max_bin));
+        return result;
+    };
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+//Where the engine keeps its files. The firmware implements it with FatFs on
+//the SD card, the host build with the files of a directory. One file is open
+//at a time, and everything is called from the main loop, never from the audio
+//callback: the calls can take milliseconds.
+class FileSystem {
+    public:
+    virtual ~FileSystem() {};
+
+    //for reading, or created (emptied if it is there) for writing
+    virtual bool Open(const char *name, bool write) = 0;
+    //false unless all size bytes went through. The data of a Write stays
+    //untouched until the next Write after it, so the transfer can still be
+    //going on (a DMA) when it returns
+    virtual bool Read(void *data, size_t size) = 0;
+    virtual bool Write(const void *data, size_t size) = 0;
+    //offset in bytes from the start of the file
+    virtual bool Seek(size_t offset) = 0;
+    virtual void Close() = 0;
+    //renames a file that isn't open, replacing to if it is there
+    virtual bool Rename(const char *from, const char *to) = 0;
+};
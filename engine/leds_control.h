@@ -0,0 +1,109 @@
+#pragma once
+
+#include "control_surface.h"
+#include "spsc_ring.h"
+
+//Helper Class to handle leds easily.
+//The colors belong to the main loop, where UpdateLeds sends them to the
+//surface. The audio callback never writes them: it Post()s what it wants
+//and the next UpdateLeds applies it.
+class LedsControl {
+    int times[4];
+
+    float flash_color[4][3];
+    float base_color[4][3];
+
+    ControlSurface *surface = nullptr;
+
+    //from the audio callback: a base color, or a flash of times cycles
+    struct Request {
+        int idx;
+        bool flash;
+        int times;
+        float r, g, b;
+    };
+    //16 blocks of the meters of a mode, a request that doesn't fit is lost
+    //(the meters send a new one each block)
+    SpscRing<Request, 64> requests;
+
+    void Post(int idx, bool flash, int _times, float r, float g, float b) {
+        Request *request = requests.Back();
+        if (request) {
+            *request = {idx, flash, _times, r, g, b};
+            requests.Push();
+        }
+    };
+
+    public:
+    LedsControl(){
+      Reset();
+    };
+    ~LedsControl() {};
+
+    void Init(ControlSurface *_surface) {
+        surface = _surface;
+        Reset();
+    }
+
+    void Reset() {
+        SwitchAllOff();
+      //trick to initialize everything to black
+      for (int i = 0; i < 4; i++) {
+        SetForXCycles(i,-1,0,0,0);
+      }
+    }
+    void SetForXCycles(int idx, int _times, float r, float g, float b) {
+        flash_color[idx][0] = r;
+        flash_color[idx][1] = g;
+        flash_color[idx][2] = b;
+        times[idx] = _times;
+    };
+    void SwitchAllOff() {
+        SetAllLeds(0,0,0);
+    };
+    void SwitchOffLed(int idx) {
+         surface->SetLed(idx,0,0,0);
+    };
+
+    void SetAllLeds(float r, float g, float b) {
+        for (int i = 0; i < 4; i++) {
+            SetBaseColor(i,r,g,b);
+        }
+    }
+
+    void SetBaseColor(int idx, float r, float g, float b) {
+        base_color[idx][0] = r;
+        base_color[idx][1] = g;
+        base_color[idx][2] = b;
+    }
+
+    //audio callback side of SetForXCycles and SetBaseColor
+    void PostForXCycles(int idx, int _times, float r, float g, float b) {
+        Post(idx, true, _times, r, g, b);
+    };
+    void PostBaseColor(int idx, float r, float g, float b) {
+        Post(idx, false, 0, r, g, b);
+    };
+
+    void UpdateLeds() {
+        const Request *request;
+        while ((request = requests.Front()) != nullptr) {
+            if (request->flash) {
+                SetForXCycles(request->idx, request->times, request->r, request->g, request->b);
+            } else {
+                SetBaseColor(request->idx, request->r, request->g, request->b);
+            }
+            requests.Pop();
+        }
+        //handle flashing leds
+        for (int i = 0; i < 4; i++) {
+            surface->SetLed(i,base_color[i][0],base_color[i][1],base_color[i][2]);
+            if (times[i] > 0) {
+                times[i]--;
+                surface->SetLed(i, flash_color[i][0],flash_color[i][1],flash_color[i][2]);
+            }
+        }
+        surface->UpdateLeds();
+    };
+
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cmath>
+
+//Logarithmic knob curve, same math as daisy::Parameter with the LOGARITHMIC
+//curve, but it maps a knob value it is given instead of owning the
+//AnalogControl, so it can be used without the hardware.
+class LogParameter {
+    float lmin, lmax;
+
+    public:
+    LogParameter() {};
+    ~LogParameter() {};
+
+    void Init(float min, float max) {
+        //avoid log(0)
+        lmin = logf(min < 0.0000001f ? 0.0000001f : min);
+        lmax = logf(max);
+    };
+
+    float Process(float knob_value) {
+        return expf((knob_value * (lmax - lmin)) + lmin);
+    };
+};
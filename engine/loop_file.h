@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "file_system.h"
+
+//A loop kept in a file: a header sector, then the frames as interleaved 16 bit
+//stereo. It goes through a chunk at a time, so that the main loop can save or
+//load it between two control cycles. The chunks alternate between two
+//buffers: the one handed to the FileSystem last isn't touched while the next
+//is filled, a FileSystem with DMA can still be writing it. The buffers are
+//aligned to the cache lines and the full chunks (and the header) are whole
+//sectors of the SD card, so that they go straight to the card. The last
+//chunk is what is left of the loop: its end isn't on a sector boundary, the
+//FileSystem takes care of that part.
+//A save goes to a temporary file that only replaces the loop once complete,
+//with the header written last: a save that didn't finish isn't a loop, and
+//the previous one is still there.
+class LoopFile {
+    public:
+    static const size_t kChunkFrames = 2048;
+
+    private:
+    static const size_t kSectorSize = 512;
+    static const uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t sample_rate;
+        //in frames
+        uint32_t length;
+    };
+
+    alignas(32) int16_t buffers[2][2 * kChunkFrames];
+    int current;
+    FileSystem *file_system;
+    const char *name;
+    const char *temp_name;
+    Header header;
+    uint32_t done;
+
+    static_assert(sizeof(buffers[0]) % kSectorSize == 0, "the chunks aren't whole sectors");
+
+    bool WriteHeader(const Header &h) {
+        //the sector it is in is a buffer the FileSystem is done with
+        int16_t *sector = buffers[current];
+        memset(sector, 0, kSectorSize);
+        memcpy(sector, &h, sizeof(h));
+        return file_system->Write(sector, kSectorSize);
+    };
+
+    public:
+    LoopFile() : current(0), file_system(nullptr), name(nullptr), temp_name(nullptr), done(0) {
+        memset(&header, 0, sizeof(header));
+    };
+    ~LoopFile() {};
+
+    bool IsOpen() const {
+        return file_system != nullptr;
+    };
+
+    //frames of the loop, and how many went through so far
+    uint32_t Length() const {
+        return header.length;
+    };
+    uint32_t Done() const {
+        return done;
+    };
+    bool Finished() const {
+        return done >= header.length;
+    };
+    //frames in the next chunk
+    size_t ChunkFrames() const {
+        return header.length - done < kChunkFrames ? header.length - done : kChunkFrames;
+    };
+
+    //a loop of length frames for _name, written to _temp_name until EndSave()
+    bool BeginSave(FileSystem *fs, const char *_name, const char *_temp_name, uint32_t length, uint32_t sample_rate) {
+        Close();
+        if (!fs->Open(_temp_name, true)) {
+            return false;
+        }
+        file_system = fs;
+        name = _name;
+        temp_name = _temp_name;
+        done = 0;
+        memset(&header, 0, sizeof(header));
+        if (!WriteHeader(header)) {
+            Close();
+            return false;
+        }
+        memcpy(header.magic, "MVLP", 4);
+        header.version = kVersion;
+        header.sample_rate = sample_rate;
+        header.length = length;
+        current ^= 1;
+        return true;
+    };
+
+    //where the next chunk is to be put, ChunkFrames() frames of it
+    int16_t *Buffer() {
+        return buffers[current];
+    };
+
+    //writes the chunk of Buffer(), the next one goes to the other buffer
+    bool Save() {
+        size_t frames = ChunkFrames();
+        if (!file_system->Write(buffers[current], frames * 2 * sizeof(int16_t))) {
+            Close();
+            return false;
+        }
+        done += frames;
+        current ^= 1;
+        return true;
+    };
+
+    //the header, once every chunk is written, and the loop takes the place
+    //of the previous one
+    bool EndSave() {
+        FileSystem *fs = file_system;
+        bool ok = Finished() && fs->Seek(0) && WriteHeader(header);
+        Close();
+        return ok && fs->Rename(temp_name, name);
+    };
+
+    //opens a loop saved at this sample rate, of up to max_length frames
+    bool BeginLoad(FileSystem *fs, const char *_name, uint32_t max_length, uint32_t sample_rate) {
+        Close();
+        if (!fs->Open(_name, false)) {
+            return false;
+        }
+        file_system = fs;
+        done = 0;
+        int16_t *sector = buffers[current];
+        if (!file_system->Read(sector, kSectorSize)) {
+            Close();
+            return false;
+        }
+        memcpy(&header, sector, sizeof(header));
+        if (memcmp(header.magic, "MVLP", 4) || header.version != kVersion || header.sample_rate != sample_rate
+            || header.length == 0 || header.length > max_length) {
+            Close();
+            return false;
+        }
+        return true;
+    };
+
+    //reads the next chunk, ChunkFrames() frames, nullptr if it can't
+    const int16_t *Load() {
+        size_t frames = ChunkFrames();
+        current ^= 1;
+        if (!file_system->Read(buffers[current], frames * 2 * sizeof(int16_t))) {
+            Close();
+            return nullptr;
+        }
+        done += frames;
+        return buffers[current];
+    };
+
+    void Close() {
+        if (file_system) {
+            file_system->Close();
+            file_system = nullptr;
+        }
+    };
+};
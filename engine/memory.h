@@ -0,0 +1,27 @@
+#pragma once
+
+//Buffer placement. On the Versio big buffers go to the external SDRAM and
+//small ones that are read every sample can go to the DTCM, on the host build
+//(TEST) they are plain statics.
+//
+//engine/memory_plan.txt says where each big buffer has to be, "make
+//memory-report" checks it against the map file of the firmware build.
+//Buffers placed in a section have to be global, the map file only names the
+//statics that have a section of their own.
+#ifndef DSY_SDRAM_BSS
+#ifdef TEST
+#define DSY_SDRAM_BSS
+#else
+#define DSY_SDRAM_BSS __attribute__((section(".sdram_bss")))
+#endif
+#endif
+
+//the section is in libDaisy's linker script. It isn't cleared at startup,
+//what goes there has to be initialized by its owner
+#ifndef DSY_DTCM_BSS
+#ifdef TEST
+#define DSY_DTCM_BSS
+#else
+#define DSY_DTCM_BSS __attribute__((section(".dtcmram_bss")))
+#endif
+#endif
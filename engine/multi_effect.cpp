@@ -0,0 +1,3134 @@
+#include "daisysp.h"
+#include <atomic>
+#include <string>
+#include "../dsp/block_reverb.h"
+#include "../dsp/filter.h"
+#include "../dsp/loop_reader.h"
+#include "../dsp/parameter_interpolator.h"
+#include "../dsp/pitch_shifter.h"
+#include "../dsp/sample_storage.h"
+#include "arena.h"
+#include "memory.h"
+#include "leds_control.h"
+#include "log_parameter.h"
+#include "multi_effect.h"
+#include "profiler.h"
+#include "double_buffer.h"
+#include "spsc_ring.h"
+#include "dry_wet_mixer.h"
+#include "loop_file.h"
+#include "parameters.h"
+#include "real_fft.h"
+
+using namespace daisysp;
+
+static ControlSurface *surface;
+
+//State of the front panel as read by MultiEffectControls, before mapping
+struct ControlSnapshot {
+    float knobs[ControlSurface::KNOB_LAST];
+    int switches[ControlSurface::SW_LAST];
+    bool gate_trig;
+    bool tap_rising_edge;
+};
+
+//The mapped parameters go from the main loop to the audio callback through
+//the double buffer, the callback works on its own copy (params)
+static DoubleBuffer<EffectParameters> parameters;
+static EffectParameters params;
+//written only by the main loop
+static EffectParameters control_params;
+static uint32_t gate_count = 0;
+//last count seen by the audio callback
+static uint32_t gate_count_read = 0;
+
+#ifdef ENABLE_PROFILER
+CallbackProfiler profiler;
+#endif
+
+#define FFT_LENGTH 1024
+#define MAX_SPECTRA_FREQUENCIES 6
+#define MAX_DELAY static_cast<size_t>(48000 * 2.5f)   //2.5 seconds max delay in the fast ram
+//SDRAM shared by the modes, a bit less than the 64 MB of the Versio
+#define SDRAM_POOL_SIZE (63 * 1024 * 1024)
+//looper samples are 16 bit unless the build asks for floats (make
+//LOOPER_FLOAT=1)
+#ifdef LOOPER_FLOAT_STORAGE
+typedef FloatStorage LooperStorage;
+#else
+typedef S16Storage LooperStorage;
+#endif
+typedef LooperStorage::Type LooperSample;
+//the looper records in a ring as big as half the pool, 172 seconds in 16 bit
+//(86 in float), the overdub layers take the other half
+#define LOOPER_MAX_SIZE static_cast<int>(SDRAM_POOL_SIZE / (4 * sizeof(LooperSample)))
+//longest loop, half the ring so that a frozen loop and the live one both fit.
+//The play positions are floats, they keep half a sample of precision there
+#define LOOPER_MAX_LEN (LOOPER_MAX_SIZE / 2)
+//overdub layers on a frozen loop: as many as fit in the pool, up to 8 (two of
+//the longest loop)
+#define LOOPER_MAX_LAYERS 8
+//a second tap within this many seconds is a double tap, it removes a layer
+#define LOOPER_DOUBLE_TAP 0.4f
+//what a block of the looper may read per sample on each side, the loop and
+//its layers together: above it the sinc gives way to the Hermite
+#define LOOPER_TAP_BUDGET 64
+#define DELAY_MAX_SIZE (48000 * 60 * 1) // 1 minutes stereo of floats at 48 khz
+
+//TO ADD: COMPLETE VOICE (ADSR + VCA + FILTER + REVERB)
+//NATURAL GATE: LPG with SPECTRAL ANALISYS FOR NOTE HEIGHT, NOTE REPETITION DISTANCE
+//CLOCKED DELAY NORMALE
+
+const char *modes[NUM_MODES] = { "Reverb", "Resonator", 
+                             "Filter", "LO-FI", "MicroLooper",  "Delay", "Spectra", "Spectrings", "Natural Gate"};
+
+#define NUM_DELAY_TIMES 17
+
+#define RMS_SIZE 48
+#define REVERB_BLOCK_SIZE 64
+#define LOOPER_BLOCK_SIZE 64
+#define NUM_OF_STRINGS 2
+
+const float delay_times[NUM_DELAY_TIMES] = {0.0078125,0.015625, 0.03125, 0.25/6.f, 0.046875, 0.0625,
+                        0.25/3.f, 0.09375, 0.125, 0.5/3.f, 0.1875, 0.25, 1.f/3.f, 
+                        0.375, 0.5f, 0.75f, 1.f};
+//These are reusable between effects to save memory
+static BlockReverb                               rev;
+
+//The SDRAM buffers of the modes come from one arena (see UseArena). The pool
+//is global so that the map file names it
+alignas(32) uint8_t DSY_SDRAM_BSS sdram_pool[SDRAM_POOL_SIZE];
+static Arena arena;
+
+//which buffers a mode takes from the arena, the modes with the same owner
+//share them
+enum ArenaOwner {
+    ARENA_NONE,
+    ARENA_DELAY_LINES,
+    ARENA_LOOPER,
+    ARENA_DELAY,
+};
+//owner of what is in the arena now, ARENA_NONE while it changes hands
+static std::atomic<int> arena_owner(ARENA_NONE);
+//main loop only: owner whose buffers are being cleared
+static int arena_pending_owner = ARENA_NONE;
+//callback only: the owner the previous block saw
+static int arena_owner_read = ARENA_NONE;
+//bytes cleared per call of MultiEffectControls, about a millisecond of SDRAM
+//writes
+#define ARENA_CLEAR_CHUNK (256 * 1024)
+
+static_assert(4 * DELAY_MAX_SIZE * sizeof(float) <= SDRAM_POOL_SIZE, "the delay buffers don't fit in the pool");
+
+//resonator and lo-fi
+static DelayLine<float, MAX_DELAY>                *dell;
+static DelayLine<float, MAX_DELAY>                *delr;
+
+
+
+static Svf                                       svfl;
+static Svf                                       svfr;
+
+static stmlib::Svf                               svf2l;
+static stmlib::Svf                               svf2r;
+
+
+static Tone                                      tonel;
+static Tone                                      toner;
+
+static Biquad                                   biquad;
+
+static StringVoice                         string_voice[NUM_OF_STRINGS];
+
+const size_t kMaxFftSize = FFT_LENGTH;
+typedef RealFft<kMaxFftSize> FFT;
+
+
+const size_t FFT_SIZE = FFT_LENGTH;
+static_assert((FFT_SIZE & (FFT_SIZE - 1)) == 0, "the analysis input ring wraps with a mask");
+//Individual parameters for each effect
+//static Parameter crusher_cutoff_par, crusher_crushrate_par;
+static LogParameter lofi_tone_par, lofi_rate_par;
+static LogParameter lofi_reverb_tone_par,lofi_reverb_rate_par;
+static LogParameter filter_cutoff_l_par, filter_cutoff_r_par;
+static LogParameter delay_cutoff_par;
+static DcBlock dcblock_l, dcblock_r;
+static DcBlock dcblock_2l, dcblock_2r;
+
+int CHRM_SCALE[128] = {8176	,8662	,9177	,9723	,10301	,10913	,11562	,12250	,12978	,13750	,14568	,15434	,16352	,17324	,18354	,19445	,20602	,21827	,23125	,24500	,25957	,27500	,29135	,30868	,32703	,34648	,36708	,38891	,41203	,43654	,46249	,48999	,51913	,55000	,58270	,61735	,65406	,69296	,73416	,77782	,82407	,87307	,92499	,97999	,103826	,110000	,116541	,123471	,130813	,138591	,146832	,155563	,164814	,174614	,184997	,195998	,207652	,220000	,233082	,246942	,261626	,277183	,293665	,311127	,329628	,349228	,369994	,391995	,415305	,440000	,466164	,493883	,523251	,554365	,587330	,622254	,659255	,698456	,739989	,783991	,830609	,880000	,932328	,987767	,1046502	,1108731	,1174659	,1244508	,1318510	,1396913	,1479978	,1567982	,1661219	,1760000	,1864655	,1975533	,2093005	,2217461	,2349318	,2489016	,2637020	,2793826	,2959955	,3135963	,3322438	,3520000	,3729310	,3951066	,4186009	,4434922	,4698636	,4978032	,5274041	,5587652	,5919911	,6271927	,6644875	,7040000	,7458620	,7902133	,8372018	,8869844	,9397273	,9956063	,10548080	,11175300	,11839820	,12543850} ;
+bool scale_12[12] = {1,1,1,1,1,1,1,1,1,1,1,1};
+bool scale_7[12] = {1,0,1,0,1,1,0,1,0,1,0,1};
+bool scale_6[12] = {1,0,1,0,1,1,0,1,0,1,0,0};
+bool scale_5[12] = {1,0,1,0,0,1,0,1,0,1,0,0};
+bool scale_4[12] = {1,0,1,0,0,1,0,1,0,0,0,0};
+bool scale_3[12] = {1,0,0,0,0,1,0,1,0,0,0,0};
+bool scale_2[12] = {1,0,0,0,0,0,0,1,0,0,0,0};
+bool scale_1[12] = {1,0,0,0,0,0,0,0,0,0,0,0};
+
+
+
+int mode = REV;
+//mode of the front panel, seen by the main loop
+int control_mode = mode;
+
+float attack_lut[300];
+
+//Individual Variables for each effect
+//shimmer: an octave up on each side, and on the sum two octaves up in the
+//reverb or an octave down in the resonator. The left and right windows
+//differ so the grains don't line up. They are read and written every sample,
+//so they sit in the DTCM
+PitchShifter<4096> DSY_DTCM_BSS reverb_shimmer_l;
+PitchShifter<4096> DSY_DTCM_BSS reverb_shimmer_r;
+PitchShifter<8192> DSY_DTCM_BSS reverb_shimmer_2;
+
+float reverb_previous_inl, reverb_previous_inr = 0;
+float reverb_current_outl, reverb_current_outr = 0;
+//what goes in and out of the reverb in the block modes
+float DSY_DTCM_BSS reverb_block_inl[REVERB_BLOCK_SIZE], reverb_block_inr[REVERB_BLOCK_SIZE];
+float DSY_DTCM_BSS reverb_block_outl[REVERB_BLOCK_SIZE], reverb_block_outr[REVERB_BLOCK_SIZE];
+
+int   reverb_rmsCount;
+float reverb_current_RMS, reverb_target_RMS, reverb_feedback_RMS=0.f;
+float reverb_target_compression;
+DryWetMixer reverb_mixer;
+
+
+//smoothed on the control side
+float resonator_current_regen = 0.5f;
+float target_resonator_feedback = 0.001f;
+int   resonator_rmsCount;
+float resonator_previous_l, resonator_previous_r = 0.f;
+
+float resonator_current_RMS, resonator_target_RMS, resonator_feedback_RMS=0.f;
+float resonator_current_delay, resonator_target =0.f;
+float resonator_previous_drywet, resonator_previous_feedback, resonator_previous_rev_send = 0.f;
+
+//int   crusher_crushmod, crusher_crushcount;
+//float crusher_crushsl, crusher_crushsr;
+//float crusher_cutoff;
+float filter_target_l_freq, filter_target_r_freq, filter_current_l_freq, filter_current_r_freq = 0.5f;
+float filter_previous_serial, filter_previous_parallel = 0.f;
+
+float lofi_current_RMS, lofi_target_RMS;
+float lofi_damp_speed;
+int   lofi_rate_count;
+int   lofi_rmsCount;
+float lofi_target_Lofi_LFO_Freq, lofi_current_Lofi_LFO_Freq;
+float lofi_previous_variable_compressor;
+float global_sample_rate;
+float lofi_previous_left_saturation, lofi_previous_right_saturation;
+float lofi_current_left_saturation, lofi_current_right_saturation;
+float lofi_previous_mono, lofi_previous_makeup = 0.f;
+DryWetMixer lofi_mixer;
+
+
+
+bool mlooper_play  = false; //currently playing
+
+float                 mlooper_pos_1 = 0;
+float                 mlooper_pos_2 = 0;
+
+int modified_buffer_length_l, modified_buffer_length_r;
+int modified_frozen_buffer_length_l, modified_frozen_buffer_length_r;
+
+
+//The record ring, LOOPER_MAX_SIZE each, in the arena. Every input sample is
+//written once at mlooper_head. The loop is the last mlooper_len samples
+//before the head, seen through the writer phase (mlooper_writer_pos, from 0
+//to mlooper_len) that the play positions are relative to.
+LooperSample *mlooper_buf_1l;
+LooperSample *mlooper_buf_1r;
+int mlooper_head = 0;
+
+//Freezing keeps the head and the phase of that moment: the frozen loop is
+//the part of the ring before mlooper_frozen_head, which the writer skips
+//until the freeze is released
+int mlooper_frozen_head = 0;
+int mlooper_frozen_writer_pos = 0;
+
+
+
+
+int                 mlooper_len    = 0;
+int                 mlooper_len_count = 0;
+
+
+
+float                 mlooper_frozen_pos_1 = 0;
+float                 mlooper_frozen_pos_2 = 0;
+
+int mlooper_frozen_len = 0;
+DryWetMixer mlooper_mixer;
+//Overdub layers on the frozen loop, from the arena after the ring: a tap
+//starts recording one, the next tap stops it, a double tap removes the last
+//one. A layer is laid out like the frozen loop (index 0 is its oldest
+//sample) and plays once its first pass is written: stopped before that, it
+//goes on recording silence until then. They go with the frozen loop.
+LooperSample *mlooper_layer_l[LOOPER_MAX_LAYERS], *mlooper_layer_r[LOOPER_MAX_LAYERS];
+//what the arena had used before each layer, an undo gives it back
+size_t mlooper_layer_mark[LOOPER_MAX_LAYERS];
+int mlooper_layers = 0;
+//the newest layer takes the input
+bool mlooper_overdub = false;
+//where the newest layer is written (its index, in time with the frozen
+//loop) and how much of its first pass is done
+int mlooper_layer_phase = 0;
+int mlooper_layer_written = 0;
+//samples since the last tap, for the double taps
+int mlooper_tap_time = LOOPER_MAX_LEN;
+static uint32_t mlooper_tap_count_read = 0;
+//freezing before the first gate loads the saved loop: until it is in, the
+//writer keeps off the LOOPER_MAX_LEN samples before the frozen head, where the
+//main loop puts it. The request count is odd while the callback waits
+bool mlooper_loading = false;
+static std::atomic<uint32_t> mlooper_load_request(0);
+//the last request the main loop is done with, and the length of the loop it
+//loaded (0 if none), written before
+static std::atomic<uint32_t> mlooper_load_done(0);
+static int mlooper_load_len = 0;
+
+//The frozen loop, as the callback last described it to the main loop that
+//saves it (see StreamLoopFile): published on a freeze and when a layer is
+//kept or removed. The callback counts what it publishes, the main loop reads
+//it again if the count moved meanwhile (the callback can interrupt it, not
+//the other way round)
+struct LooperSnapshot {
+    //ring index of the oldest sample
+    int start;
+    int len;
+    int layers;
+};
+static LooperSnapshot mlooper_snapshot;
+static std::atomic<uint32_t> mlooper_snapshot_count(0);
+
+//Looper persistence, main loop only: nullptr without a file system (no SD
+//card). The chunk buffers are global so that the map file names them, the
+//DMA of the SD card doesn't reach the DTCM
+#define LOOP_FILE_NAME "loop.mvl"
+#define LOOP_FILE_TEMP_NAME "loop.tmp"
+static FileSystem *file_system = nullptr;
+LoopFile loop_file;
+enum LoopFileState {
+    LOOP_FILE_IDLE,
+    LOOP_FILE_SAVING,
+    LOOP_FILE_LOADING,
+};
+static int loop_file_state = LOOP_FILE_IDLE;
+//the loop being saved, and the snapshot count it is from
+static LooperSnapshot loop_file_loop;
+static uint32_t loop_file_count = 0;
+//last load request seen
+static uint32_t loop_file_request = 0;
+
+//reads the loops, and what a block of ProcessLooper reads on each side
+typedef LoopReader<LooperStorage, LOOPER_MAX_SIZE> LooperReader;
+LooperReader mlooper_reader;
+LoopPosition mlooper_block_pos_1[LOOPER_BLOCK_SIZE], mlooper_block_pos_2[LOOPER_BLOCK_SIZE];
+float mlooper_block_att_1[LOOPER_BLOCK_SIZE], mlooper_block_att_2[LOOPER_BLOCK_SIZE];
+float mlooper_block_out_1[LOOPER_BLOCK_SIZE], mlooper_block_out_2[LOOPER_BLOCK_SIZE];
+float mlooper_previous_att_1, mlooper_previous_att_2 = 0.f;
+
+bool mlooper_frozen = false;
+int mlooper_writer_pos = 0;
+
+std::string mlooper_division_string_1 = "";
+std::string mlooper_division_string_2 = "";
+
+std::string mlooper_play_speed_string_1 = "";
+std::string mlooper_play_speed_string_2 = "";
+
+//DELAY_MAX_SIZE each, in the arena
+float *delay_buf_l;
+float *delay_buf_r;
+float *delay_frozen_buf_l;
+float *delay_frozen_buf_r;
+
+float delay_mult_l[2], delay_mult_r[2]; 
+
+int delay_time_count = 0;
+int delay_write_pos = 0;
+int delay_control_counter,delay_time_trig = 0;
+int delay_control_latency_ms = 20;
+int delay_pos_l[2], delay_pos_r[2];
+int delay_time[2];
+float delay_outl[2], delay_outr[2];
+int delay_left_counter, delay_right_counter = 0;
+int delay_left_counter_4, delay_right_counter_4 = 0;
+int delay_main_counter = 0;
+int delay_active = 0;
+int delay_inactive = 1;
+float delay_xfade_current = 0;
+float delay_xfade_target = 0;
+//between the two delay lines, 0 is line 0 and 1 is line 1
+DryWetMixer delay_xfade_mixer;
+
+
+int delay_frozen_start;
+int delay_frozen_end;
+int delay_frozen_pos;
+ float delay_target_cutoff =0.0f;
+//smoothed on the control side
+float delay_cutoff = 0.f;
+bool delay_frozen = false;
+//samples written to the frozen buffers since the delay got them, a freeze
+//waits for a delay time of them
+int delay_recorded = 0;
+float delay_prev_sample_l, delay_prev_sample_r = 0.f;
+bool delay_reduce_spikes_l, delay_reduce_spikes_r = false;
+float delay_spike_counter_l, delay_spike_counter_r = 1.f;
+
+int delay_rmsCount = 0;
+float delay_target_RMS, delay_feedback_RMS, delay_fast_feedback_RMS = 0.0f;
+float delay_previous_input_gain, delay_previous_feedback = 0.f;
+DryWetMixer delay_mixer;
+
+
+
+
+int spectra_waveform = 0;
+float spectra_r,spectra_g,spectra_b = 0.f;
+float spectra_prev_knob_wave_knob = 0.f;
+int spectra_num_active = MAX_SPECTRA_FREQUENCIES;
+const int spectra_max_num_frequencies = MAX_SPECTRA_FREQUENCIES;
+int spectra_oct = 0;
+int spectra_hop = 1;
+std::string spectra_oct_string;
+float spectra_reverb_amount= 0.f;
+bool spectra_do_analisys = false;
+int   spectra_rmsCount = 0;
+float spectra_current_RMS, spectra_target_RMS = 1.f;
+DryWetMixer spectra_mixer;
+float spectra_rotate_harmonics = 0.0f;
+
+int spectrings_num_models = 2;
+int spectrings_active_voices = 2;
+int spectrings_current_voice = 0;
+bool spectrings_trigger_next_cycle = false;
+//the string of a gate is plucked once the analysis of the gate is in: the
+//result count it waits for, and the blocks left before it goes without it
+#define SPECTRINGS_TRIGGER_MAX_WAIT 4
+uint32_t spectrings_trigger_count = 0;
+int spectrings_trigger_wait = 0;
+
+DryWetMixer spectrings_mixer;
+
+size_t spectrings_attack_step[NUM_OF_STRINGS];
+size_t spectrings_attack_last_step[NUM_OF_STRINGS];
+float spectrings_accent_amount [NUM_OF_STRINGS];
+float spectrings_decay_amount [NUM_OF_STRINGS];
+//Helper functions
+void ApplyParameters();
+
+//The reverb parameters move in linear ramps over each block. The callers of
+//GetReverbSample make one of these per block and it steps once per sample,
+//when it goes out of scope the ramps store where they ended.
+struct ReverbRamps {
+    stmlib::ParameterInterpolator compression;
+    explicit ReverbRamps(size_t size);
+};
+
+void GetReverbSample(float &outl, float &outr, float inl, float inr, ReverbRamps &ramps);
+
+//Block processing, one call per audio callback for the active mode. The
+//output can be the same buffer as the input, so effects can be chained.
+void ProcessReverb(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessResonator(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessFilter(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessLofi(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessLooper(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessDelay(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessSpectra(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+void ProcessSpectrings(const float *inl, const float *inr, float *outl, float *outr, size_t size);
+
+int ArenaOwnerOf(int m);
+void UseArena(int owner);
+void ResetLooperBuffer();
+LoopPosition GetLooperPosition(int head, int writer_pos, int len, float pos);
+LoopQuality GetLooperQuality(float speed, int layers);
+int GetLooperPlayingLayers();
+void ToggleLooperLayer();
+void DropLooperLayer();
+void ClearLooperLayers();
+void WriteLooperLayer(float in_1l, float in_1r);
+void FreezeLooperBuffer();
+void PublishLooperSnapshot();
+void SetLooperLoading(bool loading);
+void FinishLooperLoad();
+void StreamLoopFile();
+void AnalyseSpectra();
+void SelectLooperDivision(float knob_value_1, float knob_value_2, LooperParameters *looper);
+void SelectLooperPlaySpeed(float knob_value_1, float knob_value_2, LooperParameters *looper);
+void SelectDelayDivision(float new_delay_mult_l, float new_delay_mult_r);
+
+float clamp(float value,float min,float max) {
+    if (value < min){
+        return min;
+    }
+    if (value > max){
+        return max;
+    }
+    return value;
+};
+
+
+float map(float value, float start1, float stop1, float start2, float stop2) {
+    return start2 + ((stop2 - start2) * (value - start1) )/ (stop1 - start1);
+};
+
+//Value a fonepole with this coefficient reaches after size samples: a linear
+//ramp to it over the block follows the same glide with one add per sample.
+float OnePoleBlockTarget(float current, float target, float coeff, size_t size) {
+    return target + (current - target) * powf(1.f - coeff, (float)size);
+};
+
+
+void leftRotatebyOne(float arr[], int n)
+{
+    float temp = arr[0];
+    for (int i = 0; i < n - 1; i++)
+        arr[i] = arr[i + 1];
+    arr[n-1] = temp;
+}
+
+void rightRotatebyOne(float arr[], int n)
+{
+    float temp = arr[n-1];
+    for (int i = n-1; i > 0; i--)
+        arr[i] = arr[i - 1];
+    arr[0] = temp;
+}
+ 
+/*Function to left rotate arr[] of size n by d*/
+void leftRotate(float arr[], float amount, int n)
+{
+    for (int i = 0; i < amount*n; i++)
+        leftRotatebyOne(arr, n);
+}
+
+/*Function to left rotate arr[] of size n by d*/
+void rightRotate(float arr[], float amount, int n)
+{
+    for (int i = 0; i < amount*n; i++)
+        rightRotatebyOne(arr, n);
+}
+
+int getClosest(int, int, int);
+ 
+// Returns element closest to target in arr[]
+int findClosest(int arr[],const bool filter[], int n, int target, int offset)
+{
+   int lower = 0;
+   int higher = n;
+   int reverse_counter = 0;
+   for (int i = 0; i< n; i++) {
+       if ((arr[i] < target) & filter[(i+offset)%12]) {
+           lower = arr[i];
+       }
+       reverse_counter = (n-1)-i;
+       if ((arr[reverse_counter] > target) & filter[(reverse_counter+offset)%12]) {
+           higher = arr[reverse_counter];
+       }
+       
+   }
+   return getClosest(lower, higher, target);
+};
+ 
+// Method to compare which one is the more close.
+// We find the closest by taking the difference
+// between the target and both values. It assumes
+// that val2 is greater than val1 and target lies
+// between these two.
+int getClosest(int val1, int val2,
+               int target)
+{
+    if (target - val1 >= val2 - target)
+        return val2;
+    else
+        return val1;
+}
+
+
+
+void SelectSpectraOctave(float knob_value_1, SpectraParameters *spectra){
+    //sets the octave shift
+    if (knob_value_1 < 0.2f){
+        spectra->oct_mult = 0.25f;
+        spectra_oct_string = "-2";
+    } else if (knob_value_1 < 0.4f){
+        spectra->oct_mult = 0.5f;
+        spectra_oct_string = "-1";
+    } else if (knob_value_1 < 0.6f){
+        spectra->oct_mult = 1.f;
+        spectra_oct_string = " 0";
+    } else if (knob_value_1 < 0.8f){
+        spectra->oct_mult = 2.f;
+        spectra_oct_string = "+1";
+    } else if (knob_value_1 > 0.8f){
+        spectra->oct_mult = 4.f;
+        spectra_oct_string = "+2";
+    }
+};
+
+void swap(float *xp, float *yp)
+{
+    int temp = *xp;
+    *xp = *yp;
+    *yp = temp;
+}
+ 
+// A function to implement bubble sort
+void bubbleSort(float arr[],float arr2[],  int n)
+{
+    int i, j;
+    for (i = 0; i < n-1; i++)    
+     
+    // Last i elements are already in place
+    for (j = 0; j < n-i-1; j++)
+        if (arr[j] < arr[j+1]){
+            swap(&arr[j], &arr[j+1]);
+            swap(&arr2[j], &arr2[j+1]);
+            }
+}
+
+//centre of the range of the waveform knob that selects a waveform
+float SpectraWaveformPosition(int waveform) {
+    return (waveform + 0.5f) / 9.f;
+}
+
+float ApplyWindow(float i, size_t pos, size_t FFT_SIZE) {
+        float multiplier = 0.5 * (1 - cos(2*PI_F*pos/(FFT_SIZE-1)));
+        return i * multiplier;
+}
+
+//The spectral analysis runs in the main loop, not in the callback: the
+//callback decimates the input into frames that go through spectra_frames,
+//the main loop (AnalyseSpectra) keeps the last FFT_SIZE samples and analyses
+//them when a frame comes with a gate, the callback gets the frequencies and
+//magnitudes it found through spectra_results.
+//A frame is the decimated samples of a block, or a part of them for the
+//bigger blocks. The frame that ends the block of a gate has gate set, and
+//the hop the samples were decimated with
+#define SPECTRA_FRAME_SIZE 32
+struct SpectraFrame {
+    float samples[SPECTRA_FRAME_SIZE];
+    size_t size;
+    size_t hop;
+    bool gate;
+};
+
+//the analysis of a gate, count tells the callback it is a new one
+struct SpectraResult {
+    float freq[MAX_SPECTRA_FREQUENCIES];
+    float magn[MAX_SPECTRA_FREQUENCIES];
+    uint32_t count;
+};
+
+//32 blocks the main loop can be late by, a frame that doesn't fit is lost
+static SpscRing<SpectraFrame, 32> spectra_frames;
+static DoubleBuffer<SpectraResult> spectra_results;
+//main loop only
+static uint32_t spectra_result_count = 0;
+
+class OscBank {
+    static const int number_of_osc = spectra_max_num_frequencies;
+    Oscillator osc[number_of_osc];
+    float freq[number_of_osc];
+    float magn[number_of_osc];
+
+    float current_freq[number_of_osc];
+    float current_magn[number_of_osc];
+    int num_active = spectra_num_active;
+    float output_mult, prev_output_mult = 0.f;
+    float amp_attenuation = 1.f;
+    int previous_wave = 0;
+    int current_wave = 0;
+    size_t attack_step[number_of_osc];
+    bool mark_to_change_waveform[number_of_osc];
+    //the frame with the gate is still to be sent, it goes with the next
+    //one if it didn't fit
+    bool analysis_gate = false;
+    //frames sent with a gate, the main loop gives their results the same
+    //count
+    uint32_t gate_count = 0;
+    uint32_t result_count = 0;
+
+    public:
+    size_t hop = 8;
+    OscBank(){};
+    ~OscBank() {};
+
+    void Init(float sample_rate) {
+        for (int i = 0; i< number_of_osc; i++) {
+            osc[i].Init(sample_rate);
+            //float randomPhase = (rand() %1000)/1000.f;
+            //osc[i].PhaseAdd(randomPhase);
+            freq[i] = 0;
+            magn[i] = 0;
+            current_freq[i] = 0;
+            current_magn[i] = 0;
+            osc[i].SetWaveform(0);
+            attack_step[i] = 0;
+            mark_to_change_waveform[i] = false;
+        };
+    };
+    void SetFreq(int index, float frequency) {
+        osc[index].SetFreq(frequency);
+    };
+    void SetAmp(int index, float amplitude) {
+        osc[index].SetAmp(amplitude);
+    };
+    void SetAllWaveforms(int waveform) {
+        current_wave = 0;
+        
+        switch(waveform) {
+            case 0:
+                current_wave = 0;
+                amp_attenuation = 1.f;
+                break;
+            case 1:
+                current_wave = 8;
+                amp_attenuation = 1.f;
+                break;
+            case 2:
+                current_wave = 1;
+                amp_attenuation = 0.9f;
+                break;
+            case 3:
+                current_wave = 5;
+                amp_attenuation = 0.9f;
+                break;
+            case 4:
+                current_wave = 7;
+                amp_attenuation = 0.35f;
+                break;
+            case 5:
+                current_wave = 2;
+                amp_attenuation = 0.40f;
+                break;
+            case 6:
+                current_wave = 3;
+                amp_attenuation = 0.45f;
+                break;
+            case 7:
+                current_wave = 6;
+                amp_attenuation = 0.45f;
+                break;
+            case 8:
+                current_wave = 4;
+                amp_attenuation = 0.4f;
+                break;
+        }
+
+
+        
+            for (int i = 0; i< number_of_osc; i++) {
+                //the second time it actually changes the waveform, so the attack lut can avoid clicks
+                if (mark_to_change_waveform[i]) {
+                    osc[i].SetWaveform(current_wave);
+                    mark_to_change_waveform[i] = false;
+                }
+                //the first time it just marks the waveform to be changed
+                if (previous_wave != current_wave) {
+                    
+                    mark_to_change_waveform[i] = true;
+                    attack_step[i] = 0;
+                }; 
+            }
+            if (previous_wave != current_wave) {
+                    previous_wave= current_wave;
+            }
+    };
+
+    float Process() {
+        float output = 0;
+        for (int i = 0; i< spectra_max_num_frequencies; i++) {
+            output_mult = ((0.5 + 0.2/num_active) + prev_output_mult*47.f) /48.f;
+            output = output + osc[i].Process()* output_mult * attack_lut[attack_step[i]];
+            attack_step[i] = clamp(attack_step[i]+1, 0, 299);
+            prev_output_mult = output_mult;
+        };
+        return output;
+    }
+    //decimates the input, the samples go to the main loop
+    void FillInputBuffer(float *in1,float *in2,  size_t size) {
+        float bandSize = global_sample_rate/(FFT_SIZE*hop);
+
+        size_t real_size = size / hop;
+        svfl.SetRes(0.1);
+        svfl.SetFreq(global_sample_rate/(2*hop));
+        svfr.SetRes(0.1);
+        svfr.SetFreq(bandSize*(32/hop));
+        for (size_t first = 0; first < real_size; first += SPECTRA_FRAME_SIZE) {
+            size_t frame_size = std::min(real_size - first, (size_t)SPECTRA_FRAME_SIZE);
+            //the main loop is late: the samples are lost, not the gate
+            SpectraFrame *frame = spectra_frames.Back();
+            SpectraFrame lost;
+            if (!frame) {
+                frame = &lost;
+            }
+            for (size_t i = first; i < first + frame_size; i++) {
+                float sum = 0.f;
+                for (size_t j = 0; j < hop; j++) {
+                    float sample = (in1[i*hop + j] + in2[i*hop + j])*0.707;
+                    svfl.Process(sample); 
+                    svfr.Process(svfl.Low());
+                    sum = sum + svfr.High() / hop;
+                }
+                frame->samples[i - first] = sum;
+            };
+            if (frame != &lost) {
+                frame->size = frame_size;
+                frame->hop = hop;
+                frame->gate = analysis_gate && first + frame_size == real_size;
+                analysis_gate = analysis_gate && !frame->gate;
+                gate_count += frame->gate;
+                spectra_frames.Push();
+            }
+        }
+    }
+
+    //a gate: the main loop analyses the last FFT_SIZE input samples, up to
+    //the ones of this block
+    void CalculateSpectralAnalisys() {
+        analysis_gate = true;
+    }
+    //the count the result of a gate asked for now will come with
+    uint32_t NextResultCount() {
+        return gate_count + 1;
+    }
+    uint32_t ResultCount() {
+        return result_count;
+    }
+
+    //the frequencies of the last analysis the main loop is done with
+    void ReadAnalysis() {
+        const SpectraResult &result = spectra_results.Front();
+        if (result.count == result_count) {
+            return;
+        }
+        result_count = result.count;
+        for (int i = 0; i < spectra_max_num_frequencies; i++) {
+            freq[i] = result.freq[i];
+            magn[i] = i < num_active ? result.magn[i] : 0.f;
+        }
+        //rightRotate(magn,spectra_rotate_harmonics, num_active);
+    }
+    float getFrequency(int value) {
+        return current_freq[value];
+    }
+    float getMagnitudo(int value) {
+        return current_magn[value];
+    }
+
+    void updateFreqAndMagn() {
+        for (int i = 0; i< spectra_max_num_frequencies; i++ ) {
+            float new_freq = (freq[i] +  current_freq[i]*47)/48;
+            SetFreq(i,new_freq); 
+            current_freq[i] = new_freq;
+
+            float new_magn = ((magn[i] +  current_magn[i]*47)/48);
+            SetAmp(i,current_magn[i]*amp_attenuation);
+            current_magn[i] = new_magn;
+        }
+    }
+
+    void calculatedSuggestedHop() {
+        
+        //if ((current_freq[0]/params.spectra.oct_mult) > 110) {
+        hop = 16;
+        //}
+        //if ((current_freq[0]) > 880) {
+        //    hop = 8;
+        //} 
+        //if ((current_freq[0]) > 1760) {
+        //    hop = 4;
+        //}
+  
+
+    }
+    void SetNumActive(int value) {
+        num_active = value;
+    };
+};
+
+//Main loop side of the spectral analysis: the decimated input, and what the
+//analysis of a gate goes through
+class SpectraAnalyzer {
+    //the last FFT_SIZE decimated input samples, a ring: the oldest one is at
+    //fftin_head, where the next one goes
+    float fftinbuff[FFT_SIZE];
+    size_t fftin_head = 0;
+    float window[FFT_SIZE];
+    float window_fftinbuff[FFT_SIZE];
+    float fftoutbuff[FFT_SIZE];
+    float magni_fftoutbuff[FFT_SIZE/2];
+    float bandSize;
+    FFT fft;
+
+    public:
+    SpectraAnalyzer() {};
+    ~SpectraAnalyzer() {};
+
+    void Init() {
+        fftin_head = 0;
+        for (size_t i = 0; i < FFT_SIZE; i++) {
+            fftinbuff[i] = 0;
+            fftoutbuff[i] = 0;
+            if (i < FFT_SIZE/2){
+            magni_fftoutbuff[i] = 0;
+            }
+            window[i] = ApplyWindow(1.0f, i,FFT_SIZE );
+        }
+        fft.Init();
+    };
+
+    //adds the samples to the input ring, over the oldest ones
+    void AddInput(const float *samples, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            fftinbuff[fftin_head] = samples[i];
+            fftin_head = (fftin_head + 1) & (FFT_SIZE - 1);
+        }
+    }
+
+    //the input as it is now, decimated by hop, analysed with the settings
+    //of spectra
+    void Analyse(size_t hop, const SpectraParameters &spectra, SpectraResult *result) {
+        bandSize = global_sample_rate/(FFT_SIZE*hop);
+        WindowInput();
+        fft.Direct(window_fftinbuff, fftoutbuff);
+        CalculateMagnitudes(hop);
+
+        float max_amp = 20.0f;
+        for (int i = 0; i < spectra_max_num_frequencies; i++) {
+            FindPeak(spectra, &max_amp, &result->freq[i], &result->magn[i]);
+        }
+    }
+
+    private:
+    //the ring from its oldest sample, windowed: the part up to the end of
+    //the ring, then the part from its start
+    void WindowInput() {
+        size_t first = FFT_SIZE - fftin_head;
+        for (size_t i = 0; i < first; i++) {
+            window_fftinbuff[i] = window[i]*fftinbuff[fftin_head + i];
+        }
+        for (size_t i = first; i < FFT_SIZE; i++) {
+            window_fftinbuff[i] = window[i]*fftinbuff[i - first];
+        }
+    }
+
+    void CalculateMagnitudes(size_t hop) {
+        for (size_t i = 0; i<FFT_SIZE / 2; i++){
+            if (i<32/hop){
+                fftoutbuff[i] =fftoutbuff[i] * 0.5;
+            }
+            float real = fftoutbuff[i];
+            float imag = fftoutbuff[i+(FFT_SIZE / 2)];
+            magni_fftoutbuff[i] = sqrt(real*real+imag*imag);
+        }
+    }
+
+    //the loudest band left, the bands around it are removed
+    void FindPeak(const SpectraParameters &spectra, float *max_amp, float *freq, float *magn) {
+        const int N = sizeof(magni_fftoutbuff) / sizeof(float);
+        int a = std::distance(magni_fftoutbuff, std::max_element(magni_fftoutbuff, magni_fftoutbuff + (N/2)));
+
+        *freq = a*bandSize*spectra.oct_mult;
+        if (spectra.quantize >0) {
+
+            *freq = findClosest(CHRM_SCALE, spectra.selected_scale,128, ((int)*freq*1000), spectra.transpose) /1000.f;
+        };
+        *max_amp = std::max(magni_fftoutbuff[a], *max_amp) ;
+        *magn = ((magni_fftoutbuff[a]/ *max_amp)*(1-spectra.lower_harmonics) + spectra.lower_harmonics);
+
+        if (*freq > global_sample_rate / 2) {
+            *freq = 0.0f;
+            *magn = 0.0f;
+        }
+
+        RemoveNearestBands(a*bandSize, a, spectra.spread);
+    }
+    void RemoveNearestBands(float frequency, size_t start_band, float spread) {
+        magni_fftoutbuff[start_band] = 0.f;
+        float upper_frequency = mtof((int)((12.f*log2(frequency/440.f) + 69 + 1)));
+        for (size_t i = start_band; (((i*bandSize/spread)< upper_frequency) & (i<FFT_SIZE/2) & (-i>0)) ; i++) {
+            float mult = map((i*bandSize/spread),(1*bandSize/spread), upper_frequency, 0.0f, 1.0f);
+            magni_fftoutbuff[i] = magni_fftoutbuff[i] * mult;
+            magni_fftoutbuff[-i] = magni_fftoutbuff[-i] * mult;
+        }
+
+    }
+};
+
+class Averager {
+
+    float buffer[RMS_SIZE];
+    int cursor;
+    public:
+    
+    Averager() {
+        Clear();
+    }
+    ~Averager() {}
+    
+    float ProcessRMS() {
+        float sum = 0.f;
+        for (int i =0; i< cursor; i++) {
+            sum = sum + buffer[i];
+        }
+        float result = sqrt(sum/cursor);
+        Clear();
+        return result;
+    }
+    void Clear() {
+        for (int i =0; i< RMS_SIZE; i++) {
+            buffer[i] = 0.f;
+        }
+        cursor = 0;
+    }
+    void Add(float sample){
+        buffer[cursor] = sample;
+        cursor++;
+    }
+};
+
+static Averager lofi_averager;
+static Averager reverb_averager;
+static Averager delay_averager;
+
+
+
+static Averager resonator_averager;
+static OscBank spectra_oscbank;
+//main loop only
+static SpectraAnalyzer spectra_analyzer;
+static Averager spectra_averager;
+static LedsControl leds;
+
+
+void SelectResonatorOctave(float knob_value_1, ResonatorParameters *resonator){
+    //sets the octave shift
+    if (knob_value_1 < 0.2f){
+        resonator->octave = 1;
+    } else if (knob_value_1 < 0.4f){
+        resonator->octave = 2;
+    } else if (knob_value_1 < 0.6f){
+        resonator->octave = 4;
+    } else if (knob_value_1 < 0.8f){
+        resonator->octave = 8;
+    } else if (knob_value_1 > 0.8f){
+        resonator->octave = 16;
+    }
+};
+
+void SelectSpectraQuality(float knob_value_1, SpectraParameters *spectra){
+    //sets the octave shift
+    if (knob_value_1 < 0.25f){
+        spectra->hop = 2;
+    } else if (knob_value_1 < 0.5f){
+        spectra->hop = 4;
+    } else if (knob_value_1 < 0.75f){
+        spectra->hop = 8;
+    } else if (knob_value_1 > 0.75f){
+        spectra->hop = 16;
+    }
+};
+
+void MultiEffectProcess(float **in, float **out, size_t size)
+{
+    PROFILE_BEGIN();
+    //the arena changed hands, the frozen buffers that were in it are gone:
+    //the freezes go too, so that one still held takes again once the mode
+    //has its buffers (and the looper's loads the saved loop)
+    int owner_now = arena_owner.load(std::memory_order_acquire);
+    if (owner_now != arena_owner_read) {
+        arena_owner_read = owner_now;
+        if (mlooper_loading) {
+            SetLooperLoading(false);
+        }
+        mlooper_frozen = false;
+        delay_frozen = false;
+        delay_recorded = 0;
+    }
+    ApplyParameters();
+    PROFILE_MARK(STAGE_CONTROLS);
+
+    if ((mode == SPECTRA) or (mode == SPECTRINGS)) {
+        if (spectra_do_analisys) {
+            spectra_do_analisys = false;
+            spectra_oscbank.CalculateSpectralAnalisys();
+        }
+        spectra_oscbank.FillInputBuffer(in[0],in[1] , size);
+        spectra_oscbank.ReadAnalysis();
+
+        if (mode == SPECTRINGS) { 
+            string_voice[spectrings_current_voice].SetFreq(spectra_oscbank.getFrequency(spectrings_current_voice));
+            //the main loop is late with the analysis: the string waits for
+            //it, not to be plucked at the note before
+            if (spectrings_trigger_next_cycle
+                && (spectra_oscbank.ResultCount() >= spectrings_trigger_count || --spectrings_trigger_wait <= 0)) {
+                string_voice[spectrings_current_voice].SetDamping(spectrings_decay_amount[spectrings_current_voice]);
+                string_voice[spectrings_current_voice].Trig();
+                spectrings_trigger_next_cycle = false;
+            }
+        }
+    };
+    PROFILE_MARK(STAGE_ANALYSIS);
+
+    //the buffers of the mode are still being set up in the arena, the
+    //input goes through meanwhile
+    int owner = ArenaOwnerOf(mode);
+    if (owner != ARENA_NONE && owner != arena_owner.load(std::memory_order_acquire)) {
+        for(size_t i = 0; i < size; i++) {
+            out[0][i] = in[0][i];
+            out[1][i] = in[1][i];
+        }
+        PROFILE_MARK(STAGE_AUDIO);
+        PROFILE_END(mode, size);
+        return;
+    }
+
+    //audio: the mode is chosen once per block, the chained effects run
+    //one after the other on the output buffers
+    switch(mode)
+    {
+        case REV: ProcessReverb(in[0], in[1], out[0], out[1], size); break;
+        case RESONATOR: ProcessResonator(in[0], in[1], out[0], out[1], size); break;
+        case FILTER: ProcessFilter(in[0], in[1], out[0], out[1], size); break;
+        case LOFI: 
+            ProcessReverb(in[0], in[1], out[0], out[1], size);
+            ProcessLofi(out[0], out[1], out[0], out[1], size);
+            break;
+        case MLOOPER: ProcessLooper(in[0], in[1], out[0], out[1], size); break;
+        case SPECTRA: ProcessSpectra(in[0], in[1], out[0], out[1], size); 
+             ProcessReverb(out[0], out[1], out[0], out[1], size);
+             break;
+        case DELAY: ProcessDelay(in[0], in[1], out[0], out[1], size); 
+            break;
+        case SPECTRINGS: ProcessSpectrings(in[0], in[1], out[0], out[1], size); 
+             ProcessReverb(out[0], out[1], out[0], out[1], size);
+             break;
+
+        default:
+            for(size_t i = 0; i < size; i++) {
+                out[0][i] = out[1][i] = 0.f;
+            }
+    }
+    PROFILE_MARK(STAGE_AUDIO);
+    PROFILE_END(mode, size);
+
+};
+
+void MultiEffectInit(float sample_rate, ControlSurface *control_surface, FileSystem *files)
+{
+    surface = control_surface;
+    file_system = files;
+    leds.Init(surface);
+#ifdef ENABLE_PROFILER
+    profiler.Init(sample_rate);
+#endif
+
+    rev.Init(sample_rate);
+    arena.Init(sdram_pool, sizeof(sdram_pool));
+
+    tonel.Init(sample_rate);
+    toner.Init(sample_rate);
+    svfl.Init(sample_rate);
+    svfl.SetFreq(0.0);
+    svfl.SetRes(0.5);
+    svfr.Init(sample_rate);
+    svfr.SetFreq(0.0);
+    svfr.SetRes(0.5);
+
+    svf2l.Init();
+    svf2r.Init();
+
+    biquad.Init(sample_rate);
+    biquad.SetCutoff(0.0);
+    biquad.SetRes(0.5);
+
+    global_sample_rate = sample_rate;
+    dcblock_l.Init(sample_rate);
+    dcblock_r.Init(sample_rate);
+    dcblock_2l.Init(sample_rate);
+    dcblock_2r.Init(sample_rate);
+
+    lofi_damp_speed = sample_rate;
+    lofi_target_Lofi_LFO_Freq = lofi_current_Lofi_LFO_Freq = sample_rate;
+    lofi_current_RMS = lofi_target_RMS = 0.f;
+    lofi_previous_left_saturation = lofi_previous_right_saturation = 0.5f;
+    lofi_current_left_saturation = lofi_current_right_saturation = 0.5f;
+    lofi_previous_variable_compressor = 0.0f;
+
+
+    //crusher_cutoff_par.Init(60, 20000);
+    //crusher_crushrate_par.Init(1, 50);
+    filter_cutoff_l_par.Init(60, 20000);
+    filter_cutoff_r_par.Init(60, 20000);
+
+    delay_cutoff_par.Init(400, 20000);
+    
+    delay_pos_l[0] = 0;
+    delay_pos_r[1] = 0;
+    delay_time[0] = -1;
+    delay_time[1] = -1;
+    delay_outl[0] = 0;
+    delay_outr[0] = 0;
+    delay_outl[1] = 0;
+    delay_outr[1] = 0;
+    delay_mult_l[0] = 1; 
+    delay_mult_r[0] = 1;
+    delay_mult_l[1] = 1; 
+    delay_mult_r[1] = 1;
+ 
+
+    lofi_tone_par.Init(20, 20000);
+    lofi_rate_par.Init(sample_rate*4, sample_rate/16);
+
+    //grains of about 65 ms, longer ones on the sum
+    reverb_shimmer_l.Init(sample_rate * 0.0625f);
+    reverb_shimmer_r.Init(sample_rate * 0.0648f);
+    reverb_shimmer_l.SetRatio(2.f);
+    reverb_shimmer_r.SetRatio(2.f);
+    reverb_shimmer_2.Init(sample_rate * 0.14f);
+    reverb_shimmer_2.SetRatio(4.f);
+
+    //reverb parameters
+    rev.SetLpFreq(9000.0f);
+    rev.SetFeedback(0.85f);
+
+    //dry/wet mixers: dry level in the middle, output level
+    reverb_mixer.Init(0.95f, 0.7f);
+    lofi_mixer.Init(0.95f, 1.f);
+    mlooper_mixer.Init(0.95f, 1.f);
+    mlooper_reader.Init();
+    delay_mixer.Init(0.7f, 1.f);
+    delay_xfade_mixer.Init(0.95f, 1.f);
+    spectra_mixer.Init(0.95f, 0.5f);
+    spectrings_mixer.Init(0.95f, 0.5f);
+
+    //delay parameters
+    resonator_current_delay = resonator_target = sample_rate * 0.75f;
+
+    for (size_t i = 0; i<300; i++) {
+        if (i<48) {
+        attack_lut[i] = map(i, 0, 48, 1.0f, 0.f); 
+        }
+        else
+        {
+        attack_lut[i] = map(i, 48, 300, 0.0f, 1.f) ; 
+        }
+    };
+
+
+    spectra_oscbank.Init(sample_rate);
+    spectra_analyzer.Init();
+
+    for (int i = 0; i < NUM_OF_STRINGS; i++)   { 
+    string_voice[i].Init(sample_rate);
+    }
+
+    //parameters that the knob mappings don't always set
+    control_params.mode = mode;
+    control_params.reverb.compression = 1.0f;
+    control_params.resonator.note = 20.f;
+    control_params.resonator.tone = 12000.f;
+    control_params.resonator.octave = 1;
+    control_params.lofi.lpg_amount = 1.0f;
+    control_params.lofi.lpg_decay = 1.0f;
+    control_params.looper.division_1 = control_params.looper.division_2 = 1.f;
+    control_params.looper.play_speed_1 = control_params.looper.play_speed_2 = 1.f;
+    control_params.looper.volume_att_1 = control_params.looper.volume_att_2 = 1.f;
+    control_params.spectra.hop = spectra_oscbank.hop;
+    control_params.spectra.num_active = spectra_num_active;
+    control_params.spectra.spread = 1.0f;
+
+    //the callback needs a first snapshot of the controls, it also hands the
+    //arena to the first mode
+    MultiEffectControls();
+}
+float randomFloat() {
+    int randomNumber = std::rand() % 10000;
+    return randomNumber / 10000.f;
+}
+
+//Tap in SPECTRA and SPECTRINGS: steps through the quantizer scales
+void SelectSpectraScale(SpectraParameters *spectra)
+{
+    spectra->quantize = (spectra->quantize + 1) % 9;
+    if (spectra->quantize >0) {
+        leds.SetBaseColor(0,0,1,0);
+        switch (spectra->quantize)
+        {
+        case 1:
+            spectra->selected_scale = scale_12;
+            leds.SetBaseColor(3,0,0,1);
+            break;
+        case 2:
+            spectra->selected_scale = scale_7;
+            leds.SetBaseColor(3,0,0,0.8);
+            break;
+        case 3:
+            spectra->selected_scale = scale_6;
+            leds.SetBaseColor(3,0,0.3,0.6);
+            break;
+        case 4:
+            spectra->selected_scale = scale_5;
+            leds.SetBaseColor(3,0,0.4,0.4);
+            break;
+        case 5:
+            leds.SetBaseColor(3,0,0.6,0.3);
+            spectra->selected_scale = scale_4;
+            break;
+        case 6:
+            leds.SetBaseColor(3,0,0.7,0.2);
+            spectra->selected_scale = scale_3;
+            break;
+        case 7:
+            leds.SetBaseColor(3,0,0.4,0.1);
+            spectra->selected_scale = scale_2;
+            break;
+        case 8:
+            leds.SetBaseColor(3,0.4,0.4,0.0);
+            spectra->selected_scale = scale_1;
+            break;
+        default:
+            break;
+        }
+    }
+    else {
+        leds.SetBaseColor(0,0,0,0);
+        leds.SetBaseColor(3,0,0,0);
+        };
+}
+
+//Control side: maps the front panel to the parameters of the current mode.
+//It runs in the main loop, so it doesn't touch the DSP objects.
+void UpdateKnobs(const ControlSnapshot &snapshot, EffectParameters *p)
+
+{
+    float blend = snapshot.knobs[ControlSurface::KNOB_0];
+    float speed = snapshot.knobs[ControlSurface::KNOB_1];
+    float tone = snapshot.knobs[ControlSurface::KNOB_2];
+    float index = snapshot.knobs[ControlSurface::KNOB_3];
+    float regen = snapshot.knobs[ControlSurface::KNOB_4];
+    float size = snapshot.knobs[ControlSurface::KNOB_5];
+    float dense = snapshot.knobs[ControlSurface::KNOB_6];
+
+    bool tap_rising_edge = snapshot.tap_rising_edge;
+
+    //the middle position, the switches only read 0, 1 or 2
+    int sw1 = 0, sw2 = 0;
+
+    switch(snapshot.switches[ControlSurface::SW_0]) {
+        case 0:
+            sw1 = 1;
+            break;
+        case 1:
+            sw1=0;
+            break;
+        case 2:
+            sw1=2;
+            break;
+    };
+
+    switch(snapshot.switches[ControlSurface::SW_1]) {
+        case 0:
+            sw2 = 3;
+            break;
+        case 1:
+            sw2=0;
+            break;
+        case 2:
+            sw2=6;
+            break;
+    };
+
+    control_mode = sw1 + sw2;
+    if (control_mode != p->mode) {
+        p->mode = control_mode;
+        leds.Reset();
+    }
+
+
+    switch(control_mode)
+    {
+        case REV:
+            //blend = reverb wet/dry
+            //tone = reverb_lowpass
+            //speed =
+            //index = shimmer
+            //regen = reverb feedback
+            //size =
+            //dense = reverb compression
+
+
+            p->reverb.lowpass = global_sample_rate*tone / 2.f;
+            p->reverb.shimmer = index;
+            p->reverb.feedback = 0.8f + (std::log10(10 + regen*90) -1.000001f)*0.4f;
+
+            p->reverb.compression = dense +0.5f;
+
+            p->reverb.drywet = blend;
+            break;
+        case RESONATOR:
+            //blend = resonator wet/dry
+            //tone = resonator tone
+            //speed = octave
+            //index = resonator note
+            //regen = resonator feedback
+            //size = reverb shimmer
+            //dense = reverb amount
+            //tap
+
+            if (tap_rising_edge){
+                p->resonator.glide_mode = (p->resonator.glide_mode + 1) % 10;
+                p->resonator.glide = p->resonator.glide_mode*p->resonator.glide_mode*p->resonator.glide_mode;
+            };
+
+
+            SelectResonatorOctave(speed, &p->resonator);
+            p->resonator.note = 12.0f + index * 60.0f;
+            p->resonator.note = static_cast<int32_t>(p->resonator.note); // Quantize to semitones
+
+
+            p->resonator.tone = global_sample_rate*tone / 4.f;
+
+            p->reverb.lowpass = p->resonator.tone*2.f;
+            p->reverb.shimmer = size*2;
+            p->reverb.feedback = 0.8f + (std::log10(10 + dense*90) -1.000001f)*1.4f;
+
+            p->reverb.drywet = dense;
+
+            p->reverb.compression = dense*2 +0.5f;
+
+            fonepole(resonator_current_regen,regen, 0.008) ;
+
+            p->resonator.feedback =  (std::log10(10 + clamp((resonator_current_regen-0.5)*2.f,0,1)   *90) -1.000001f)*1.5f -(std::log10(10 + clamp((1 - resonator_current_regen*2.f),0,1)   *90) -1.000001f)*1.5f;
+
+            p->resonator.drywet = blend*1.01;
+            break;
+
+
+        case FILTER:
+            //blend = cutoff left
+            //tone = mode left
+            //speed = resonance left
+            //index = mode right
+            //regen = cutoff right
+            //size = resonance right
+            //dense = parallel -> series
+            filter_target_l_freq = filter_cutoff_l_par.Process(blend)/ (global_sample_rate);
+            filter_target_r_freq = filter_cutoff_r_par.Process(regen)/ (global_sample_rate);
+
+            fonepole(filter_current_l_freq, filter_target_l_freq, 0.1f);
+            fonepole(filter_current_r_freq, filter_target_r_freq, 0.1f);
+
+            p->filter.freq_l = filter_current_l_freq;
+            p->filter.freq_r = filter_current_r_freq;
+            p->filter.q_l = 1.f+ speed*speed*49.f;
+            p->filter.q_r = 1.f+ size*size*49.f;
+
+            p->filter.mode_l = tone;
+            p->filter.mode_r = index;
+            p->filter.path = dense;
+
+
+            leds.SetBaseColor(0,blend*0.8,0,0);
+            leds.SetBaseColor(1,tone,0,1-tone);
+            leds.SetBaseColor(2,index,0,1-index);
+            leds.SetBaseColor(3,regen*0.8,0,0);
+
+            break;
+
+        case LOFI:
+            //blend = lofi drywet
+            //tone = lofi lpg cutoff
+            //speed = lofi rate
+            //index = lofi_depth
+            //regen = reverb amount
+            //size = lpg amount
+            //dense = lpg decay
+
+
+            p->lofi.cutoff = lofi_tone_par.Process(tone); //tone
+            p->lofi.depth = index*2;     //index
+            p->lofi.mod = (int)lofi_rate_par.Process(speed);
+            p->lofi.drywet = blend*1.01; //IMPLEMENT
+
+            p->reverb.lowpass = p->lofi.cutoff;
+            p->reverb.feedback = 0.7f + (std::log10(10 + regen*90) -1.000001f)*0.3f;
+
+            p->lofi.lpg_amount = size*size*3;
+            p->lofi.lpg_decay = clamp((1-((std::log10(10 + dense*90) -0.999991f)*0.4f +0.6f  ) ) *0.05f, 0.0001, 0.99999);
+            //Shimmer
+            p->reverb.shimmer = 0.0f;
+            p->reverb.compression = 0.5f;
+            //DRY WET
+            p->reverb.drywet = regen*0.8f;
+
+            break;
+
+        case MLOOPER:
+            //blend = looper division left
+            //tone =
+            //speed = looper octave left
+            //index = buffer freeze
+            //regen = looper division right
+            //size = looper octave right
+            //dense = dry/wet
+            //FSU = clock
+
+            //tap = overdub a layer on the frozen loop, tap again to keep
+            //it, double tap to remove the last one
+
+            //TONE = Amount of the two micro loopers
+            //INDEX = AMOUNT OF RANDOM
+            //DENSE = DRY WET //implement
+
+            p->looper.freeze = index > 0.5f;
+            if (tap_rising_edge) {
+                p->looper.tap_count++;
+            }
+
+            SelectLooperDivision(blend,regen, &p->looper);
+            SelectLooperPlaySpeed(speed,size, &p->looper);
+
+            p->looper.drywet = dense*1.01;
+
+            break;
+
+        case SPECTRA:
+            // blend = spectra drywet
+            // speed = hop
+            // index = transpose when quantizing.
+            // tone = octave
+            // size = number of waveforms + spread
+            // regen = amount of reverb + feedback
+            // dense = waveform kind
+            // tap = activate quantizer
+
+            // FSU clock
+
+            SelectSpectraQuality(1.f-speed, &p->spectra);
+
+            //the previous position adds some hysteresis to the waveform knob
+            p->spectra.waveform = (int)((dense*9 + spectra_prev_knob_wave_knob)*0.1 *9.f);
+            spectra_prev_knob_wave_knob = SpectraWaveformPosition(p->spectra.waveform);
+
+            p->spectra.num_active = ((int)(1+ (clamp(size*2, 0.0f, 1.0f)*(spectra_max_num_frequencies -0.5f))));
+
+
+            p->spectra.spread = clamp(map(size-0.5, 0.0f, 0.5f, 1.0f, 4.0f), 1.0f, 4.0f);
+            p->spectra.lower_harmonics = p->spectra.spread*0.25f;
+
+            SelectSpectraOctave(tone, &p->spectra);
+
+            p->reverb.lowpass = global_sample_rate*0.5 / 2.f;
+            p->reverb.shimmer = 0.0f;
+            p->reverb.feedback = 0.2f + (std::log10(10 + regen*90) -1.000001f)*1.0f;
+
+            p->reverb.compression = 0.5f;
+            p->spectra.drywet = blend;
+
+            p->reverb.drywet = clamp(regen*1.1f, 0.0f, 1.0f);
+
+            p->spectra.transpose = (int)std::round(index*12.f);
+            if (tap_rising_edge){
+                SelectSpectraScale(&p->spectra);
+            };
+
+            break;
+
+
+        case DELAY:
+            //blend = delay speed division left
+            //tone = feedback
+            //speed = cutoff
+            //index = buffer freeze
+            //regen = delay speed division right
+            //size = reverb
+            //dense = dry/wet
+
+            //FSU = clock
+
+            p->delay.freeze = index > 0.5f;
+            p->delay.mult_l = delay_times[(int)(blend*NUM_DELAY_TIMES)];
+            p->delay.mult_r = delay_times[(int)(regen*NUM_DELAY_TIMES)];
+
+            p->delay.feedback = size*0.1 + (std::log10(10 + tone*90) -1.000001f)*0.9f;
+            p->delay.drywet = (std::log10(10 + dense*90) -1.0f)*1.01;
+
+            delay_target_cutoff = delay_cutoff_par.Process(speed);
+            fonepole(delay_cutoff, delay_target_cutoff, 0.1f);
+            p->delay.cutoff = delay_cutoff;
+
+            p->reverb.lowpass = (global_sample_rate + global_sample_rate*(size))  / 4.f;
+            p->reverb.feedback = 0.65f + (std::log10(10 + size*90) -1.000001f)*0.20f;
+            //Shimmer
+            p->reverb.shimmer = 0.0f;
+            p->reverb.compression = 1.0f;
+            //DRY WET
+            p->reverb.drywet = size*0.75f;
+
+            break;
+
+        case SPECTRINGS:
+            // blend = dry/wet
+            // speed =  reverb
+            // index = transpose when quantizing
+            // tone = octave
+            // size = damping
+            // regen = brightness
+            // dense = inharmonicity
+            // FSU
+
+            // tap = activate quantizer
+
+            p->spectra.transpose = (int)std::round(index*12.f);
+            if (tap_rising_edge){
+                SelectSpectraScale(&p->spectra);
+            };
+
+            p->spectrings.brightness = regen;
+            p->spectrings.structure = dense;
+            p->spectrings.damping = size;
+
+            p->spectra.num_active = NUM_OF_STRINGS;
+
+            p->spectra.spread = 4.f; //clamp(map(size-0.5, 0.0f, 0.5f, 1.0f, 4.0f), 1.0f, 4.0f);
+            p->spectra.lower_harmonics = 0.0f;
+
+            SelectSpectraOctave(tone, &p->spectra);
+
+            p->spectrings.drywet = blend;
+            p->spectrings.pan_spread = 1;
+            p->reverb.lowpass = global_sample_rate*0.4*(1-speed*speed*0.6)  / 2.f;
+            p->reverb.shimmer = 0.0f;
+            p->reverb.feedback = 0.7f + (std::log10(10 + speed*90) -1.000001f)*0.299;
+
+            p->reverb.compression = 0.5f;
+            p->spectra.drywet = 1.0; //IMPLEMENT
+
+            p->reverb.drywet = clamp(map(clamp(speed*1.1f, 0.0f, 1.0f)*0.95 , 0.0, 0.95, 0.7f,0.95f),0.0f,0.95f) ;
+
+            break;
+    };
+
+}
+//void UpdateEncoder()
+//{
+//    mode = mode + patch.encoder.Increment();
+//    mode = (mode % NUM_MODES + NUM_MODES) % NUM_MODES;
+//}
+
+//Audio side: takes the latest parameters, hands them to the DSP objects and
+//reacts to the gate, at the start of each callback.
+void ApplyParameters()
+{
+    params = parameters.Front();
+    mode = params.mode;
+
+    //a gate since the previous callback
+    bool gate_trig = params.gate_count != gate_count_read;
+    gate_count_read = params.gate_count;
+
+    switch(mode)
+    {
+        case REV:
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            reverb_shimmer_2.SetRatio(4.f);
+            break;
+
+        case RESONATOR:
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            reverb_shimmer_2.SetRatio(0.5f);
+
+            tonel.SetFreq(params.resonator.tone / 2.f);
+            toner.SetFreq(params.resonator.tone / 2.f);
+
+            svfl.SetFreq(params.resonator.tone);
+            svfr.SetFreq(params.resonator.tone);
+
+            svfl.SetRes(0.001);
+            svfr.SetRes(0.001);
+            break;
+
+        case FILTER:
+            svf2l.set_f_q <stmlib::FREQUENCY_ACCURATE> (params.filter.freq_l, params.filter.q_l);
+            svf2r.set_f_q <stmlib::FREQUENCY_ACCURATE> (params.filter.freq_r, params.filter.q_r);
+            break;
+
+        case LOFI:
+            tonel.SetFreq(params.lofi.cutoff);
+            toner.SetFreq(params.lofi.cutoff);
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            break;
+
+        case MLOOPER:
+            if (gate_trig)
+            {
+                mlooper_len = mlooper_len_count % LOOPER_MAX_LEN;
+                mlooper_len_count = 0;
+                mlooper_play = true;
+                mlooper_pos_1 = (mlooper_writer_pos - mlooper_len);
+                mlooper_pos_2 = (mlooper_writer_pos - mlooper_len);
+                leds.PostForXCycles(1,10,1,1,1);
+                leds.PostForXCycles(2,10,1,1,1);
+            };
+
+            if (mlooper_loading && mlooper_load_done.load(std::memory_order_acquire)
+                                   == mlooper_load_request.load(std::memory_order_relaxed)) {
+                FinishLooperLoad();
+            }
+
+            if (params.looper.freeze)
+            {
+                if (mlooper_frozen == false)
+                {
+                    mlooper_frozen = true;
+                    FreezeLooperBuffer();
+                }
+
+            } else
+            {
+              if (mlooper_frozen) {
+                  ClearLooperLayers();
+                  SetLooperLoading(false);
+              }
+              mlooper_frozen = false;
+            }
+
+            if (params.looper.tap_count != mlooper_tap_count_read) {
+                mlooper_tap_count_read = params.looper.tap_count;
+                ToggleLooperLayer();
+            }
+            break;
+
+        case SPECTRA:
+            spectra_oscbank.hop = params.spectra.hop;
+            spectra_oscbank.SetAllWaveforms(params.spectra.waveform);
+            spectra_oscbank.SetNumActive(params.spectra.num_active);
+
+            if (gate_trig) {
+                spectra_do_analisys = true;
+                spectra_r = randomFloat();
+                spectra_g = randomFloat();
+                spectra_b = randomFloat();
+                leds.PostBaseColor(1,spectra_r,spectra_g,spectra_b);
+                leds.PostBaseColor(2,spectra_r,spectra_g,spectra_g);
+            }
+
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            break;
+
+        case DELAY:
+            if (gate_trig)
+            {
+                delay_time_trig = delay_time_count;
+                delay_time_count = 0;
+                leds.PostForXCycles(1,10,1,0.5f,0.5f);
+                leds.PostForXCycles(2,10,1,0.5f,0.5f);
+            };
+
+            //Change delay length only if the difference is higher than 0.5 milliseconds
+            //to avoid clicks for micro changes in the delay time
+            if (delay_control_counter == 0)
+            {   delay_time[delay_inactive] = delay_time[delay_active];
+                delay_mult_l[delay_inactive] = delay_mult_l[delay_active];
+                delay_mult_r[delay_inactive] = delay_mult_r[delay_active];
+
+                if (delay_time_trig > 0)
+                {
+
+                    //if (abs(delay_time[delay_active] - ((delay_time_count*4) % DELAY_MAX_SIZE)) > 48)
+
+                    delay_time[delay_inactive] = (delay_time_trig *4) % DELAY_MAX_SIZE;
+                    //this line sets the crossfade to move to the other side
+                    delay_xfade_target=delay_inactive;
+
+                    delay_time_trig = 0;
+
+
+                    if (delay_main_counter == 0) {
+                        delay_left_counter = (delay_write_pos - delay_pos_l[delay_active]) / 4;
+                        delay_right_counter = (delay_write_pos - delay_pos_r[delay_active]) / 4;
+                        delay_right_counter_4 = delay_left_counter_4 = 0;
+
+                    } ;
+                    delay_main_counter = (delay_main_counter +1) % 4;
+                };
+
+                if (params.delay.freeze)
+                {
+                    if (!delay_frozen && delay_recorded >= delay_time[delay_active]) {
+                        delay_frozen = true;
+                        delay_frozen_end = delay_write_pos;
+                        delay_frozen_start = (delay_write_pos-delay_time[delay_active]+ DELAY_MAX_SIZE) % DELAY_MAX_SIZE;
+                        delay_frozen_pos= delay_frozen_start;
+                        }
+                } else
+                {
+                delay_frozen = false;
+                }
+
+                SelectDelayDivision(params.delay.mult_l, params.delay.mult_r);
+                }
+
+            delay_control_counter = (delay_control_counter + 1) % delay_control_latency_ms;
+
+            tonel.SetFreq(params.delay.cutoff);
+            toner.SetFreq(params.delay.cutoff);
+            //svf2l.set_f_q <stmlib::FREQUENCY_DIRTY> (params.delay.cutoff, 1.f);
+            //svf2r.set_f_q <stmlib::FREQUENCY_DIRTY> (params.delay.cutoff, 1.f);
+
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            break;
+
+        case SPECTRINGS:
+            spectra_oscbank.calculatedSuggestedHop();
+            for (int i = 0; i < NUM_OF_STRINGS; i++)   {
+                string_voice[i].SetBrightness(spectra_oscbank.getMagnitudo(i)*params.spectrings.brightness);
+
+                string_voice[i].SetAccent(spectra_oscbank.getMagnitudo(i));
+
+                string_voice[i].SetStructure(params.spectrings.structure);
+
+            }
+            spectra_oscbank.SetNumActive(params.spectra.num_active);
+
+            if (gate_trig) {
+                spectra_do_analisys = true;
+                spectrings_current_voice = (spectrings_current_voice +1) % spectrings_active_voices;
+
+                spectrings_trigger_next_cycle = true;
+                spectrings_trigger_count = spectra_oscbank.NextResultCount();
+                spectrings_trigger_wait = SPECTRINGS_TRIGGER_MAX_WAIT;
+                spectrings_accent_amount[spectrings_current_voice] = spectra_oscbank.getMagnitudo(spectrings_current_voice) ;
+                spectrings_decay_amount[spectrings_current_voice] = params.spectrings.damping;
+                spectrings_attack_step[spectrings_current_voice] = 0;
+
+                if (spectrings_current_voice == 0) {
+                    leds.PostForXCycles(1,10,1,1,1);
+                } else {
+                    leds.PostForXCycles(2,10,1,1,1);
+                };
+
+                }
+
+            rev.SetLpFreq(params.reverb.lowpass);
+            rev.SetFeedback(params.reverb.feedback);
+            break;
+    };
+}
+
+//which buffers of the arena a mode needs
+int ArenaOwnerOf(int m)
+{
+    switch(m)
+    {
+        case RESONATOR:
+        case LOFI:
+            return ARENA_DELAY_LINES;
+        case MLOOPER:
+            return ARENA_LOOPER;
+        case DELAY:
+            return ARENA_DELAY;
+        default:
+            return ARENA_NONE;
+    }
+}
+
+//Main loop side: gives the arena to other buffers. The callback doesn't run
+//a mode whose buffers aren't in the arena (the input goes through instead),
+//and it can't run halfway through this (see DoubleBuffer), so the previous
+//owner never sees its memory reused.
+//The buffers that need zeroes are cleared by the next calls of
+//MultiEffectControls, a chunk each, the new owner takes the arena after that.
+void UseArena(int owner)
+{
+    arena_owner.store(ARENA_NONE, std::memory_order_release);
+    arena_pending_owner = owner;
+    arena.Reset();
+    dell = delr = nullptr;
+    mlooper_buf_1l = mlooper_buf_1r = nullptr;
+    delay_buf_l = delay_buf_r = delay_frozen_buf_l = delay_frozen_buf_r = nullptr;
+
+    //the sizes are fixed and checked against the pool, nothing can fail here
+    switch(owner)
+    {
+        case ARENA_DELAY_LINES:
+            dell = arena.Create<DelayLine<float, MAX_DELAY>>();
+            delr = arena.Create<DelayLine<float, MAX_DELAY>>();
+            //1 MB, cleared by DelayLine
+            dell->Init();
+            delr->Init();
+            dell->SetDelay(resonator_current_delay);
+            delr->SetDelay(resonator_current_delay);
+            arena.MarkCleared();
+            break;
+        case ARENA_LOOPER:
+            //never read past what was recorded since the reset, see
+            //ResetLooperBuffer
+            mlooper_buf_1l = arena.Allocate<LooperSample>(LOOPER_MAX_SIZE);
+            mlooper_buf_1r = arena.Allocate<LooperSample>(LOOPER_MAX_SIZE);
+            ResetLooperBuffer();
+            arena.MarkCleared();
+            break;
+        case ARENA_DELAY:
+            //the delay times can reach back further than what was written
+            delay_buf_l = arena.Allocate<float>(DELAY_MAX_SIZE);
+            delay_buf_r = arena.Allocate<float>(DELAY_MAX_SIZE);
+            delay_frozen_buf_l = arena.Allocate<float>(DELAY_MAX_SIZE);
+            delay_frozen_buf_r = arena.Allocate<float>(DELAY_MAX_SIZE);
+            break;
+    }
+}
+
+void MultiEffectControls()
+{
+    surface->ProcessAnalogControls();
+    //patch.ProcessDigitalControls();
+
+    ControlSnapshot snapshot;
+    for (int i = 0; i < ControlSurface::KNOB_LAST; i++) {
+        snapshot.knobs[i] = surface->GetKnobValue(i);
+    }
+    for (int i = 0; i < ControlSurface::SW_LAST; i++) {
+        snapshot.switches[i] = surface->ReadSwitch(i);
+    }
+    surface->DebounceTap();
+    snapshot.tap_rising_edge = surface->TapRisingEdge();
+    snapshot.gate_trig = surface->GateTrig();
+    if (snapshot.gate_trig) {
+        gate_count++;
+    }
+
+    //control_params keeps the values between two calls (the knob mappings
+    //with dead zones and the tap cycles rely on it), the callback gets a copy
+    UpdateKnobs(snapshot, &control_params);
+    control_params.gate_count = gate_count;
+
+    //the modes that share buffers keep them when switching between each other
+    int owner = ArenaOwnerOf(control_params.mode);
+    if (owner != ARENA_NONE && owner != arena_owner.load(std::memory_order_relaxed)
+        && owner != arena_pending_owner) {
+        UseArena(owner);
+    }
+    if (arena_pending_owner != ARENA_NONE && arena.Clear(ARENA_CLEAR_CHUNK)) {
+        arena_owner.store(arena_pending_owner, std::memory_order_release);
+        arena_pending_owner = ARENA_NONE;
+    }
+    *parameters.Back() = control_params;
+    parameters.Publish();
+
+    StreamLoopFile();
+
+    leds.UpdateLeds();
+}
+
+void MultiEffectBackground()
+{
+    AnalyseSpectra();
+}
+
+//Main loop: takes the frames the callback decimated and analyses the input
+//at each gate, with the settings of the controls. The analysis of a frame
+//with a gate is over before the next frame goes into the input.
+void AnalyseSpectra()
+{
+    const SpectraFrame *frame;
+    while ((frame = spectra_frames.Front()) != nullptr) {
+        spectra_analyzer.AddInput(frame->samples, frame->size);
+        if (frame->gate) {
+            SpectraResult *result = spectra_results.Back();
+            spectra_analyzer.Analyse(frame->hop, control_params.spectra, result);
+            result->count = ++spectra_result_count;
+            spectra_results.Publish();
+        }
+        spectra_frames.Pop();
+    }
+}
+
+//the frozen loop as last published, and the count it was published with
+static uint32_t ReadLooperSnapshot(LooperSnapshot *snapshot)
+{
+    uint32_t count;
+    do {
+        count = mlooper_snapshot_count.load(std::memory_order_acquire);
+        *snapshot = mlooper_snapshot;
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+    } while (count != mlooper_snapshot_count.load(std::memory_order_relaxed));
+    return count;
+}
+
+//tells the callback the load asked for is over
+static void PostLoopLoad(int len)
+{
+    loop_file_state = LOOP_FILE_IDLE;
+    mlooper_load_len = len;
+    mlooper_load_done.store(loop_file_request, std::memory_order_release);
+}
+
+//Main loop: saves the frozen loop each time the callback publishes one, and
+//loads the saved one when it asks, a chunk per call. The looper keeps running
+//meanwhile: a save starts over when the loop changes under it, a load stops
+//when the callback stops waiting for it, and both when the looper gives the
+//arena back. The callback doesn't touch the frozen loop (or the part of the
+//ring kept for a load) until it publishes something else.
+void StreamLoopFile()
+{
+    bool looper = arena_owner.load(std::memory_order_acquire) == ARENA_LOOPER;
+    uint32_t request = mlooper_load_request.load(std::memory_order_acquire);
+    if (request != loop_file_request) {
+        loop_file_request = request;
+        loop_file.Close();
+        loop_file_state = LOOP_FILE_IDLE;
+        if (request & 1) {
+            if (looper && file_system
+                && loop_file.BeginLoad(file_system, LOOP_FILE_NAME, LOOPER_MAX_LEN, static_cast<uint32_t>(global_sample_rate))) {
+                loop_file_state = LOOP_FILE_LOADING;
+            } else {
+                PostLoopLoad(0);
+            }
+        }
+        return;
+    }
+    if (!looper) {
+        loop_file.Close();
+        if (loop_file_state == LOOP_FILE_LOADING) {
+            PostLoopLoad(0);
+        }
+        loop_file_state = LOOP_FILE_IDLE;
+        return;
+    }
+
+    if (loop_file_state == LOOP_FILE_LOADING) {
+        size_t frames = loop_file.ChunkFrames();
+        //the loop ends at the frozen head
+        int index = mlooper_frozen_head - static_cast<int>(loop_file.Length() - loop_file.Done());
+        index += LOOPER_MAX_SIZE & -static_cast<int>(index < 0);
+        const int16_t *chunk = loop_file.Load();
+        if (!chunk) {
+            PostLoopLoad(0);
+            return;
+        }
+        for (size_t f = 0; f < frames; f++) {
+            mlooper_buf_1l[index] = LooperStorage::Pack(S16Storage::Unpack(chunk[2 * f]));
+            mlooper_buf_1r[index] = LooperStorage::Pack(S16Storage::Unpack(chunk[2 * f + 1]));
+            if (++index >= LOOPER_MAX_SIZE) {
+                index = 0;
+            }
+        }
+        if (loop_file.Finished()) {
+            loop_file.Close();
+            PostLoopLoad(loop_file.Length());
+        }
+        return;
+    }
+
+    LooperSnapshot loop;
+    uint32_t count = ReadLooperSnapshot(&loop);
+    if (count != loop_file_count) {
+        loop_file_count = count;
+        loop_file_loop = loop;
+        loop_file_state = LOOP_FILE_IDLE;
+        if (file_system && loop_file.BeginSave(file_system, LOOP_FILE_NAME, LOOP_FILE_TEMP_NAME, loop.len,
+                                               static_cast<uint32_t>(global_sample_rate))) {
+            loop_file_state = LOOP_FILE_SAVING;
+        }
+        return;
+    }
+    if (loop_file_state == LOOP_FILE_SAVING) {
+        //the loop with its layers mixed in, from its oldest sample
+        size_t frames = loop_file.ChunkFrames();
+        int age = loop_file.Done();
+        int index = loop_file_loop.start + age;
+        index -= LOOPER_MAX_SIZE & -static_cast<int>(index >= LOOPER_MAX_SIZE);
+        int16_t *chunk = loop_file.Buffer();
+        for (size_t f = 0; f < frames; f++, age++) {
+            float l = LooperStorage::Unpack(mlooper_buf_1l[index]);
+            float r = LooperStorage::Unpack(mlooper_buf_1r[index]);
+            for (int k = 0; k < loop_file_loop.layers; k++) {
+                l += LooperStorage::Unpack(mlooper_layer_l[k][age]);
+                r += LooperStorage::Unpack(mlooper_layer_r[k][age]);
+            }
+            chunk[2 * f] = S16Storage::Pack(l);
+            chunk[2 * f + 1] = S16Storage::Pack(r);
+            if (++index >= LOOPER_MAX_SIZE) {
+                index = 0;
+            }
+        }
+        //the callback changed the loop while it was read: the next call
+        //starts over with the new one
+        if (ReadLooperSnapshot(&loop) != loop_file_count) {
+            return;
+        }
+        if (!loop_file.Save()) {
+            loop_file_state = LOOP_FILE_IDLE;
+        } else if (loop_file.Finished()) {
+            loop_file.EndSave();
+            loop_file_state = LOOP_FILE_IDLE;
+        }
+    }
+}
+
+float CompressSample(float sample) {
+    if (sample > 0.4) {
+        sample = clamp(sample - map(sample, 0.4f, 5.0f, 0.0f, 0.6f), 0.0f, 2.0f);
+    }
+    if (sample < -0.4) {
+        sample = clamp(sample - map(sample, -5.0f,-0.4f,  -0.6f, 0.0f), -2.0f, 0.0f);
+    }
+
+    if (sample > 0.8) {
+        sample = clamp(sample - map(sample, 0.8f, 2.0f, 0.0f, 0.1f), 0.0f, 0.9f);
+    }
+    if (sample < -0.8) {
+        sample = clamp(sample - map(sample, -2.0f,-0.8f,  -0.1f, 0.0f), -0.9f, 0.0f);
+    }
+    return sample;
+}
+
+ReverbRamps::ReverbRamps(size_t size)
+{
+    if (params.reverb.drywet > 0.98f) {
+        params.reverb.drywet = 1.f;
+    }
+    reverb_mixer.SetMix(params.reverb.drywet, size);
+    compression.Init(&reverb_target_compression,
+                     OnePoleBlockTarget(reverb_target_compression, params.reverb.compression, .001f, size), size);
+}
+
+//input side of one reverb sample: shimmer and limiter
+void GetReverbInput(float &suml, float &sumr, float inl, float inr, ReverbRamps &ramps)
+{
+    //Shimmer part: the input pitched up and down by the shifters
+    float shimmer_l = 0.0f;
+    float shimmer_r = 0.0f;
+    if ((mode == REV) or (mode == RESONATOR)) {
+        shimmer_l = reverb_shimmer_l.Process(inl);
+        shimmer_r = reverb_shimmer_r.Process(inr);
+        float octave2_shim = reverb_shimmer_2.Process((inl + inr) * 0.5f);
+        //the two octaves up is quieter
+        if (mode == REV) {
+            octave2_shim *= 0.5f;
+        }
+        shimmer_l += octave2_shim;
+        shimmer_r += octave2_shim;
+    }
+
+    fonepole(reverb_current_RMS, reverb_target_RMS, .1f);
+    fonepole(reverb_feedback_RMS, reverb_target_RMS, .01f);
+
+    //summing the output of the incoming audio, the previous input, and the shimmer 
+    suml = (inl + shimmer_l * params.reverb.shimmer*(params.reverb.feedback*0.5f + 0.5f)*(0.5f+reverb_current_RMS*0.5f))*0.5f;
+    sumr = (inr + shimmer_r * params.reverb.shimmer*(params.reverb.feedback*0.5f + 0.5f)*(0.5f+reverb_current_RMS*0.5f))*0.5f;
+
+    float compression = ramps.compression.Next();
+
+    //basic sample based limiter to avoid overloading the output
+    suml = CompressSample(suml*compression);
+    sumr = CompressSample(sumr*compression);
+}
+
+//RMS of the reverb output every RMS_SIZE samples
+void UpdateReverbLevel()
+{
+    reverb_rmsCount++;
+    reverb_rmsCount %= (RMS_SIZE);
+
+    if (reverb_rmsCount == 0) {
+        reverb_target_RMS = reverb_averager.ProcessRMS();
+    }
+}
+
+//output side of one reverb sample: level follower and dry/wet
+void GetReverbOutput(float &outl, float &outr, float inl, float inr, float revl, float revr)
+{
+    reverb_current_outl =  revl;
+    reverb_current_outr =  revr;
+    reverb_averager.Add((revl*revl + revr*revr)/2);
+    reverb_mixer.Mix(inl, inr, revl, revr, outl, outr);
+}
+
+//one sample of reverb, the resonator and the delay feed it back sample by sample
+void GetReverbSample(float &outl, float &outr, float inl, float inr, ReverbRamps &ramps)
+{
+    float suml, sumr, revl, revr;
+    UpdateReverbLevel();
+    GetReverbInput(suml, sumr, inl, inr, ramps);
+    rev.SetFeedback(params.reverb.feedback -reverb_feedback_RMS*0.75f);
+    rev.Process(suml, sumr, &revl, &revr);
+    GetReverbOutput(outl, outr, inl, inr, revl, revr);
+}
+
+void ProcessReverb(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{
+    ReverbRamps ramps(size);
+    //nothing feeds back around the reverb here, so it runs a block at a
+    //time and only the shimmer and the level follower go sample by sample.
+    //The feedback is ramped over the block, the level it follows is a
+    //block late
+    for (size_t start = 0; start < size; start += REVERB_BLOCK_SIZE) {
+        size_t block = std::min(size - start, static_cast<size_t>(REVERB_BLOCK_SIZE));
+        for (size_t i = 0; i < block; i++) {
+            GetReverbInput(reverb_block_inl[i], reverb_block_inr[i], inl[start + i], inr[start + i], ramps);
+        }
+        rev.SetFeedback(params.reverb.feedback -reverb_feedback_RMS*0.75f);
+        rev.Process(reverb_block_inl, reverb_block_inr, reverb_block_outl, reverb_block_outr, block);
+        for (size_t i = 0; i < block; i++) {
+            UpdateReverbLevel();
+            GetReverbOutput(outl[start + i], outr[start + i], inl[start + i], inr[start + i],
+                            reverb_block_outl[i], reverb_block_outr[i]);
+        }
+    }
+
+    //the leds are only pushed once per block, so they are set after the loop
+    if (mode == REV) {
+        leds.PostBaseColor(0,clamp(reverb_current_RMS,0,1),clamp(reverb_target_RMS,0,1),clamp(reverb_current_RMS,0,1)*clamp(reverb_current_RMS,0,1));
+        leds.PostBaseColor(1,clamp(reverb_target_RMS,0,1),clamp(reverb_target_RMS,0,1),clamp(reverb_target_RMS,0,1)*clamp(reverb_target_RMS,0,1));
+        leds.PostBaseColor(3,clamp(reverb_current_RMS,0,1),clamp(reverb_target_RMS,0,1),clamp(reverb_current_RMS,0,1)*clamp(reverb_current_RMS,0,1));
+        leds.PostBaseColor(2,clamp(reverb_target_RMS,0,1),clamp(reverb_target_RMS,0,1),clamp(reverb_target_RMS,0,1)*clamp(reverb_target_RMS,0,1));
+    }
+}
+
+
+void ProcessResonator(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{
+    //First we convert the resonator note to a Frequency (the note only changes with the knobs)
+    float resonator_target_delay = global_sample_rate / mtof(params.resonator.note) / params.resonator.octave;
+    float resonator_glide_coeff = 1/(1+params.resonator.glide*25);
+
+    ReverbRamps rev_ramps(size);
+    if (params.resonator.drywet > 0.98f) {
+        params.resonator.drywet = 1.f;
+    }
+    //how much of the reverb goes back in the delay lines
+    float resonator_rev_send = 0.15 + 0.85f*(1-params.resonator.drywet);
+
+    //The change is slightly smoothed to avoid abrupt changes in the delay line
+    stmlib::ParameterInterpolator delay_ramp(&resonator_current_delay,
+        OnePoleBlockTarget(resonator_current_delay, resonator_target_delay, resonator_glide_coeff, size), size);
+    stmlib::ParameterInterpolator drywet_ramp(&resonator_previous_drywet, params.resonator.drywet, size);
+    stmlib::ParameterInterpolator feedback_ramp(&resonator_previous_feedback, params.resonator.feedback, size);
+    stmlib::ParameterInterpolator rev_send_ramp(&resonator_previous_rev_send, resonator_rev_send, size);
+
+    for (size_t i = 0; i < size; i++) {
+        float in_l = inl[i];
+        float in_r = inr[i];
+        float drywet = drywet_ramp.Next();
+        float feedback = feedback_ramp.Next();
+        float rev_send = rev_send_ramp.Next();
+
+        // The two delays are tuned to the note frequency
+        float delay = delay_ramp.Next();
+        delr->SetDelay(delay);
+        dell->SetDelay(delay);
+
+        //RMS Calculation every RMS_SIZE n of samples. 
+        resonator_rmsCount++;
+        resonator_rmsCount %= (RMS_SIZE);
+
+        if (resonator_rmsCount == 0) {
+            resonator_target_RMS = resonator_averager.ProcessRMS();
+        }
+
+        //Setting two evelope followers at different speeds
+        fonepole(resonator_current_RMS, resonator_target_RMS, .0001f);
+        fonepole(resonator_feedback_RMS, resonator_target_RMS, .001f);
+
+        //Setting the reverb feedback to scale according to the intensity of the audio
+        //rev.SetFeedback(params.resonator.feedback -resonator_feedback_RMS*0.75f*(2.f-params.resonator.feedback));
+
+        //Reading from the delay
+        float resonator_delay_l = dell->Read();
+        float resonator_delay_r = delr->Read();
+
+        //Small saturation limiter
+        //resonator_delay_l = CompressSample(resonator_delay_l);
+        //resonator_delay_r = CompressSample(resonator_delay_r);
+
+        svfl.Process(tonel.Process(resonator_delay_l));
+        svfr.Process(toner.Process(resonator_delay_r));
+        //Filtering the output of the delay
+        float resonator_outl = svfl.Low();
+        float resonator_outr = svfr.Low();
+
+
+        float rev_outl, rev_outr;   
+
+        //Process the reverb on the incoming audio
+        GetReverbSample(rev_outl, rev_outr, (in_l*0.01 +  resonator_previous_l * 0.7f)*drywet  + (in_l*0.999 +  resonator_previous_l * 0.001f)*(1-drywet),
+                        (in_r*0.01 + resonator_previous_r*0.7f)*drywet +  (in_r*0.999 +  resonator_previous_r * 0.001f)*(1-drywet),
+                        rev_ramps);
+
+        //Adding samples to the RMS Averager
+        resonator_averager.Add((resonator_outl*resonator_outl + resonator_outr*resonator_outr)/2);
+
+        float delay_input_l = 0.f;
+        float delay_input_r = 0.f;
+        if (feedback > 0) {
+            delay_input_l = dcblock_l.Process(((feedback-resonator_current_RMS*0.85f) * (resonator_outl + rev_outl*rev_send)));
+            delay_input_r = dcblock_r.Process(((feedback-resonator_current_RMS*0.85f) * (resonator_outr + rev_outr*rev_send)));
+        }
+        else {
+            delay_input_l = dcblock_l.Process(((feedback+resonator_current_RMS*0.85f) * (resonator_outl + rev_outl*rev_send)));
+            delay_input_r = dcblock_r.Process(((feedback+resonator_current_RMS*0.85f) * (resonator_outr + rev_outr*rev_send)));
+        };
+        
+        
+        //Writing to the delay lines and ouputting the result. 
+        dell->Write(delay_input_l);
+        delr->Write(delay_input_r);
+
+        resonator_previous_l = resonator_outl;
+        resonator_previous_r = resonator_outr;
+
+        outl[i] = CompressSample(resonator_outl*0.1f);
+        outr[i] = CompressSample(resonator_outr*0.1f);
+    }
+
+    leds.PostBaseColor(0,clamp(resonator_current_RMS,0,1),clamp(resonator_current_RMS,0,1)*clamp(resonator_current_RMS,0,0.1), (params.resonator.glide_mode/10.f));
+    leds.PostBaseColor(1,clamp(resonator_feedback_RMS,0,1),clamp(resonator_feedback_RMS,0,1)*clamp(resonator_feedback_RMS,0,0.1), (params.resonator.glide_mode/10.f));
+    leds.PostBaseColor(3,clamp(resonator_current_RMS,0,1),clamp(resonator_current_RMS,0,1)*clamp(resonator_current_RMS,0,0.1), (params.resonator.glide_mode/10.f));
+    leds.PostBaseColor(2,clamp(resonator_feedback_RMS,0,1),clamp(resonator_feedback_RMS,0,1)*clamp(resonator_feedback_RMS,0,0.1), (params.resonator.glide_mode/10.f));
+}
+
+
+void ProcessFilter(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{
+    //the left output is blended in the right input, from parallel to serial filters
+    float filter_serial = sqrt(0.5f * (clamp((params.filter.path-0.05f),0.0f,1.f)*2.0f));
+    float filter_parallel = sqrt(1.f * (2.f - (params.filter.path*2)));
+
+    stmlib::ParameterInterpolator serial_ramp(&filter_previous_serial, filter_serial, size);
+    stmlib::ParameterInterpolator parallel_ramp(&filter_previous_parallel, filter_parallel, size);
+
+    svf2l.ProcessMultimode(inl,outl,size, params.filter.mode_l);
+    for (size_t i = 0; i< size; i++){
+        outr[i] = serial_ramp.Next()*outl[i] + parallel_ramp.Next() * inr[i];
+    }
+    svf2r.ProcessMultimode(outr,outr,size, params.filter.mode_r);
+
+}
+
+
+
+void ProcessLofi(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{
+    //everything that only depends on the knobs is worked out once per block
+    //when knob1 is very low an hi-pass filter activates to create a more distant sound
+    float lofi_hipass_freq = clamp(200.0 - (params.lofi.cutoff*2), 0.0f,200);
+    svfl.SetFreq(lofi_hipass_freq);
+    svfr.SetFreq(lofi_hipass_freq);
+
+    if (params.lofi.drywet > 0.98f) {
+        params.lofi.drywet = 1.f;
+    }
+    lofi_mixer.SetMix(params.lofi.drywet, size);
+
+    //amount of the other channel mixed in and of the make up gain
+    float lofi_mono = (200.f-clamp(params.lofi.cutoff, 20.f, 200.f))/200.f;
+    float lofi_makeup = (300.f-clamp(params.lofi.cutoff, 30.f, 300.f))/300.f;
+
+    stmlib::ParameterInterpolator mono_ramp(&lofi_previous_mono, lofi_mono, size);
+    stmlib::ParameterInterpolator makeup_ramp(&lofi_previous_makeup, lofi_makeup, size);
+
+    for (size_t i = 0; i < size; i++) {
+        float in_l = inl[i]*0.8f;
+        float in_r = inr[i]*0.8f;
+        float mono = mono_ramp.Next();
+        float makeup = makeup_ramp.Next();
+        //RMS calculation with smoothing for the envelope follower and the variable compressor.
+        //RMS is calculated every RMS_SIZE samples
+        lofi_rmsCount++;
+        lofi_rmsCount %= (RMS_SIZE);
+
+        if (lofi_rmsCount == 0) {
+            lofi_target_RMS = lofi_averager.ProcessRMS() * params.lofi.lpg_amount*10.f;
+        }
+
+        if (lofi_target_RMS < lofi_current_RMS){
+            fonepole(lofi_current_RMS, lofi_target_RMS, .005f * params.lofi.lpg_decay*10.f);
+        }
+        else {
+            fonepole(lofi_current_RMS, lofi_target_RMS, .05f);
+        }
+        //RMS value is stored into the averager.
+        lofi_averager.Add((in_l*in_l + in_r*in_r)/2);
+
+        //envelope follower partfor opening the lowpass filter
+        float lofi_envelope_follower = clamp(lofi_current_RMS*params.lofi.cutoff*13.0f, 20.f, 20000.f);
+
+        tonel.SetFreq(lofi_envelope_follower);
+        toner.SetFreq(lofi_envelope_follower);
+
+        rev.SetLpFreq((lofi_envelope_follower*0.6) + (global_sample_rate*0.3));
+        
+        svf2l.set_f_q <stmlib::FREQUENCY_FAST> (lofi_envelope_follower/global_sample_rate, 1.f);
+        svf2r.set_f_q <stmlib::FREQUENCY_FAST> (lofi_envelope_follower/global_sample_rate,1.f);
+
+
+        //knob 2 sets how often the delay modulation changes. This time is variable between 0 and params.lofi.mod time.
+
+        lofi_rate_count++;
+        lofi_rate_count %= params.lofi.mod;
+        if(lofi_rate_count == 0)
+        {
+            leds.PostForXCycles(1,10,0.0,0.0,0.0);
+            leds.PostForXCycles(2,10,0.0,0.0,0.0);
+
+            float r = (float) (rand() %params.lofi.mod);
+            lofi_rate_count = rand() %(params.lofi.mod);
+            lofi_target_Lofi_LFO_Freq = 0.001f + (r*params.lofi.depth)/5.f;
+            lofi_damp_speed = lofi_rate_count;
+        }
+        //This smoothing allows for the delay time to change slowly so the pitch shifting effect is subtle
+        fonepole(lofi_current_Lofi_LFO_Freq, lofi_target_Lofi_LFO_Freq, 1.0 / (1.2f * (lofi_damp_speed + (params.lofi.mod*3)/2)));    
+
+        dell->SetDelay(lofi_current_Lofi_LFO_Freq);
+        delr->SetDelay(lofi_current_Lofi_LFO_Freq);
+       
+        //here we already read the contents of the delay and assign it to the ouputs. 
+        lofi_mixer.Mix(in_l, in_r, dell->Read(), delr->Read(), outl[i], outr[i]);
+
+
+        //now we process the input and we add it to the delay line
+        //first we filter it with the two filters: low-pass-gate and hi-pass
+        //they work a bit differently. The Tone objects accepts the input as a parameter
+        //and gives back a filtered sample. The SVF accepts an input and we retrive the
+        //hi-pass ouput with High
+        float filter_outl = svf2l.Process<stmlib::FILTER_MODE_LOW_PASS>(in_l);
+        float filter_outr = svf2r.Process<stmlib::FILTER_MODE_LOW_PASS>(in_r);
+
+        svfl.Process(tonel.Process(filter_outl));
+        svfr.Process(toner.Process(filter_outr));
+        float lofi_leftFilter = svfl.High();
+        float lofi_rightFilter = svfr.High();
+
+        //Here we calculate a basic compressor using the RMS values of the envelope follower
+        //this way we compensate for the lack of volume when filtering
+        //by interpolating it with the previous state of the compressor, we slightly smooth
+        //the change avoiding potential clicks.
+        float lofi_variable_compressor = (2.f*lofi_previous_variable_compressor + makeup* (1.f-lofi_current_RMS)*1.f)*0.33f;
+        lofi_previous_variable_compressor = lofi_variable_compressor;
+
+
+        //This is a simple saturation that will contribute in enhancing the volume "vintage way"
+        //when knob 1 is low
+        float lofi_current_left_saturation = abs(in_l * in_l );
+        lofi_previous_left_saturation = (lofi_current_left_saturation + lofi_previous_left_saturation*9.f)/10.f;
+        float lofi_current_right_saturation =  abs(in_r * in_r);
+        lofi_previous_right_saturation = (lofi_current_right_saturation + lofi_previous_right_saturation*9.f)/10.f;
+
+        //Here we calculate the outputs, which are the filtered waveform plus, a certain amount of the other channel
+        //to "monoize it" when knob 1 is low, plus a certain amount of compression and saturation.
+        float lofi_left = lofi_leftFilter + (mono * lofi_rightFilter) + lofi_leftFilter * lofi_variable_compressor + lofi_leftFilter * lofi_variable_compressor*lofi_current_left_saturation*0.01f;
+        float lofi_right = lofi_rightFilter + (mono * lofi_leftFilter) + lofi_rightFilter * lofi_variable_compressor + lofi_rightFilter * lofi_variable_compressor*lofi_current_right_saturation*0.01f;
+        
+        //we still add a certain amount of the other channel to further monoize the sound
+        lofi_left = lofi_left + lofi_right* mono;
+        lofi_right = lofi_right + lofi_left* mono;
+
+        // this is a basic instantaneous saturation/limiter: if the sound is too loud (in either)
+        // directions, we compress it to avoid digital clipping.
+        if (lofi_left > 0.4) {
+            lofi_left = clamp(lofi_left - map(lofi_left, 0.4f, 10.0f, 0.0f, 0.6f), 0.0f, 1.0f);
+        }
+        if (lofi_right > 0.4) {
+            lofi_right = clamp(lofi_right - map(lofi_right, 0.4f, 10.0f, 0.0f, 0.6f), 0.0f, 1.0f);
+        }
+
+        if (lofi_left < -0.4) {
+            lofi_left = clamp(lofi_left - map(lofi_left, -10.0f,-0.4f,  -0.6f, 0.0f), -1.0f, 0.0f);
+        }
+        if (lofi_right < -0.4) {
+            lofi_right = clamp(lofi_right - map(lofi_right,  -10.0f,-0.4f,  -0.6f ,0.0f), -1.0f, 0.0f);
+        }
+
+        //we write all of this on the delayline 
+        dell->Write(lofi_left);
+        delr->Write(lofi_right);   
+    }
+
+    leds.PostBaseColor(1,lofi_current_RMS,0,0);
+    leds.PostBaseColor(0,lofi_current_RMS*lofi_current_RMS,0,0);
+    leds.PostBaseColor(3,lofi_current_RMS*lofi_current_RMS,0,0);
+    leds.PostBaseColor(2,lofi_current_RMS,0,0);
+};
+
+
+
+
+
+//Nothing is cleared: the loop is never longer than what was recorded since
+//the reset (mlooper_len counts the samples written since the last gate), so
+//the ring head is also how far the ring is valid. That makes it cheap enough
+//to run at any time, from the audio side or while the looper doesn't run.
+void ResetLooperBuffer()
+{   
+    //initialize all settings
+    mlooper_play  = false;
+    mlooper_pos_1   = 0;
+    mlooper_frozen_pos_1 = 0;
+    mlooper_pos_2  = 0;
+    mlooper_frozen_pos_2 = 0;
+    mlooper_writer_pos = 0;
+    mlooper_head = 0;
+    mlooper_frozen_head = 0;
+    mlooper_frozen_writer_pos = 0;
+    mlooper_len   = 0;
+    mlooper_frozen_len = 0;
+    mlooper_len_count = 0;
+    //the arena they were in was just reset
+    mlooper_layers = 0;
+    mlooper_overdub = false;
+}
+
+void WriteLooperBuffer(float in_1l, float in_1r)
+{   
+    //writes the input to the ring, once. While frozen the writer goes around
+    //the frozen loop: the live loop misses that part of the input, which
+    //only happens after being frozen for the rest of the ring
+    if (mlooper_frozen) {
+        int frozen_len = mlooper_loading ? LOOPER_MAX_LEN : mlooper_frozen_len;
+        int frozen_offset = mlooper_head - (mlooper_frozen_head - frozen_len);
+        if (frozen_offset < 0) {
+            frozen_offset += LOOPER_MAX_SIZE;
+        }
+        if (frozen_offset < frozen_len) {
+            return;
+        }
+    }
+    mlooper_buf_1l[mlooper_head] = LooperStorage::Pack(in_1l);
+    mlooper_buf_1r[mlooper_head] = LooperStorage::Pack(in_1r);
+};
+
+
+void FreezeLooperBuffer() {
+     //inherits the settings from the normal buffer when freezing, the
+     //samples stay where they are in the ring
+     mlooper_frozen_len = mlooper_len;
+     mlooper_frozen_head = mlooper_head;
+     mlooper_frozen_writer_pos = mlooper_writer_pos;
+     mlooper_frozen_pos_1 = mlooper_pos_1;
+     mlooper_frozen_pos_2 = mlooper_pos_2;
+     if (mlooper_frozen_len > 0) {
+         PublishLooperSnapshot();
+     } else if (arena_owner.load(std::memory_order_acquire) == ARENA_LOOPER) {
+         //nothing recorded since the reset: the saved loop, if there is one
+         SetLooperLoading(true);
+     }
+};
+
+//tells the main loop which loop it has to save
+void PublishLooperSnapshot()
+{
+    if (!mlooper_frozen || mlooper_frozen_len <= 0) {
+        return;
+    }
+    mlooper_snapshot.start = mlooper_frozen_head - mlooper_frozen_len;
+    mlooper_snapshot.start += LOOPER_MAX_SIZE & -static_cast<int>(mlooper_snapshot.start < 0);
+    mlooper_snapshot.len = mlooper_frozen_len;
+    mlooper_snapshot.layers = GetLooperPlayingLayers();
+    mlooper_snapshot_count.store(mlooper_snapshot_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void SetLooperLoading(bool loading)
+{
+    mlooper_loading = loading;
+    uint32_t request = mlooper_load_request.load(std::memory_order_relaxed);
+    if ((request & 1) != loading) {
+        mlooper_load_request.store(request + 1, std::memory_order_release);
+    }
+}
+
+//the main loop is done with the load: the saved loop ends at the frozen head,
+//or there was none
+void FinishLooperLoad()
+{
+    SetLooperLoading(false);
+    if (mlooper_load_len > 0 && arena_owner.load(std::memory_order_acquire) == ARENA_LOOPER) {
+        mlooper_frozen_len = mlooper_load_len;
+        mlooper_frozen_writer_pos = 0;
+        mlooper_frozen_pos_1 = mlooper_frozen_pos_2 = 0.f;
+        mlooper_play = true;
+        leds.PostForXCycles(1,10,0,1,0);
+        leds.PostForXCycles(2,10,0,1,0);
+    } else {
+        leds.PostForXCycles(1,10,1,0,0);
+        leds.PostForXCycles(2,10,1,0,0);
+    }
+}
+//the newest layer doesn't play until its first pass is written
+int GetLooperPlayingLayers()
+{
+    if (mlooper_layers > 0 && mlooper_layer_written < mlooper_frozen_len) {
+        return mlooper_layers - 1;
+    }
+    return mlooper_layers;
+}
+
+void ToggleLooperLayer()
+{
+    //the arena is the looper's only once UseArena is done with it
+    if (arena_owner.load(std::memory_order_acquire) != ARENA_LOOPER) {
+        return;
+    }
+    bool double_tap = mlooper_tap_time < LOOPER_DOUBLE_TAP * global_sample_rate;
+    mlooper_tap_time = 0;
+    if (double_tap) {
+        //whatever the first tap did, the last layer from before goes: the
+        //one it started goes too, the one it stopped is that one
+        if (mlooper_overdub) {
+            DropLooperLayer();
+        }
+        DropLooperLayer();
+        leds.PostForXCycles(1,10,1,0,0);
+        leds.PostForXCycles(2,10,1,0,0);
+        return;
+    }
+    if (mlooper_overdub) {
+        mlooper_overdub = false;
+        //kept, once written all around
+        if (GetLooperPlayingLayers() == mlooper_layers) {
+            PublishLooperSnapshot();
+        }
+        return;
+    }
+    //a layer needs a frozen loop, and the previous one written once around
+    if (!mlooper_frozen || mlooper_frozen_len <= 0 || mlooper_layers >= LOOPER_MAX_LAYERS
+        || GetLooperPlayingLayers() < mlooper_layers) {
+        return;
+    }
+    size_t mark = arena.Used();
+    LooperSample *layer_l = arena.Allocate<LooperSample>(mlooper_frozen_len);
+    LooperSample *layer_r = arena.Allocate<LooperSample>(mlooper_frozen_len);
+    if (!layer_l || !layer_r) {
+        //the pool is full
+        arena.Rewind(mark);
+        leds.PostForXCycles(1,10,1,0,0);
+        leds.PostForXCycles(2,10,1,0,0);
+        return;
+    }
+    //written before it is read
+    arena.MarkCleared();
+    mlooper_layer_mark[mlooper_layers] = mark;
+    mlooper_layer_l[mlooper_layers] = layer_l;
+    mlooper_layer_r[mlooper_layers] = layer_r;
+    mlooper_layers++;
+    mlooper_overdub = true;
+    mlooper_layer_written = 0;
+    //in time with the first playhead, where it is heard
+    mlooper_layer_phase = GetLooperPosition(mlooper_frozen_head, mlooper_frozen_writer_pos,
+                                            mlooper_frozen_len, mlooper_frozen_pos_1).age;
+    leds.PostForXCycles(1,10,0,1,0);
+    leds.PostForXCycles(2,10,0,1,0);
+}
+
+//the newest layer, recorded or not
+void DropLooperLayer()
+{
+    if (mlooper_layers > 0) {
+        mlooper_layers--;
+        arena.Rewind(mlooper_layer_mark[mlooper_layers]);
+    }
+    mlooper_overdub = false;
+    mlooper_layer_written = mlooper_frozen_len;
+    PublishLooperSnapshot();
+}
+
+void ClearLooperLayers()
+{
+    if (mlooper_layers > 0 && arena_owner.load(std::memory_order_acquire) == ARENA_LOOPER) {
+        arena.Rewind(mlooper_layer_mark[0]);
+    }
+    mlooper_layers = 0;
+    mlooper_overdub = false;
+}
+
+//the newest layer, at its phase: the first pass replaces what the arena had
+//there, the next ones add to it
+void WriteLooperLayer(float in_1l, float in_1r)
+{
+    LooperSample *layer_l = mlooper_layer_l[mlooper_layers - 1];
+    LooperSample *layer_r = mlooper_layer_r[mlooper_layers - 1];
+    if (!mlooper_overdub) {
+        in_1l = in_1r = 0.f;
+    }
+    if (mlooper_layer_written < mlooper_frozen_len) {
+        layer_l[mlooper_layer_phase] = LooperStorage::Pack(in_1l);
+        layer_r[mlooper_layer_phase] = LooperStorage::Pack(in_1r);
+        if (++mlooper_layer_written == mlooper_frozen_len) {
+            PublishLooperSnapshot();
+        }
+    } else {
+        layer_l[mlooper_layer_phase] = LooperStorage::Pack(LooperStorage::Unpack(layer_l[mlooper_layer_phase]) + in_1l);
+        layer_r[mlooper_layer_phase] = LooperStorage::Pack(LooperStorage::Unpack(layer_r[mlooper_layer_phase]) + in_1r);
+    }
+    if (++mlooper_layer_phase >= mlooper_frozen_len) {
+        mlooper_layer_phase = 0;
+    }
+}
+
+void SelectLooperDivision(float knob_value_1, float knob_value_2, LooperParameters *looper){
+    //sets the amount of repetitions
+    if (knob_value_1 < 0.2f){
+        looper->division_1 = 1.f;
+        mlooper_division_string_1 = " 1/1";
+    } else if (knob_value_1 < 0.4f){
+        looper->division_1 = 0.5f;
+        mlooper_division_string_1 = " 1/2";
+    } else if (knob_value_1 < 0.6f){
+        looper->division_1 = 0.25f;
+        mlooper_division_string_1 = " 1/4";
+    } else if (knob_value_1 < 0.8f){
+        looper->division_1 = 0.125f;
+        mlooper_division_string_1 = " 1/8";
+    } else if (knob_value_1 > 0.8f){
+        looper->division_1 = 0.0625f;
+        mlooper_division_string_1 = "1/16";
+    }
+
+    if (knob_value_2 < 0.2f){
+        looper->division_2 = 1.f;
+        mlooper_division_string_2 = " 1/1";
+    } else if (knob_value_2 < 0.4f){
+        looper->division_2 = 0.5f;
+        mlooper_division_string_2 = " 1/2";
+    } else if (knob_value_2 < 0.6f){
+        looper->division_2 = 0.25f;
+        mlooper_division_string_2 = " 1/4";
+    } else if (knob_value_2 < 0.8f){
+        looper->division_2 = 0.125f;
+        mlooper_division_string_2 = " 1/8";
+    } else if (knob_value_2 > 0.8f){
+        looper->division_2 = 0.0625f;
+        mlooper_division_string_2 = "1/16";
+    }
+};
+
+void SelectLooperPlaySpeed(float knob_value_1, float knob_value_2, LooperParameters *looper){
+    //sets the octave shift
+    if (knob_value_1 < 0.2f){
+        looper->play_speed_1 = 0.25f;
+        looper->volume_att_1 = 1.0f;
+        mlooper_play_speed_string_1 = "-2";
+    } else if (knob_value_1 < 0.4f){
+        looper->play_speed_1 = 0.5f;
+        looper->volume_att_1 = 1.0f;
+        mlooper_play_speed_string_1 = "-1";
+    } else if (knob_value_1 < 0.6f){
+        looper->play_speed_1 = 1.f;
+        looper->volume_att_1 = 1.0f;
+        mlooper_play_speed_string_1 = " 0";
+    } else if (knob_value_1 < 0.8f){
+        looper->play_speed_1 = 2.f;
+        looper->volume_att_1 = 0.7f;
+        mlooper_play_speed_string_1 = "+1";
+    } else if (knob_value_1 > 0.8f){
+        looper->play_speed_1 = 4.f;
+        looper->volume_att_1 = 0.5f;
+        mlooper_play_speed_string_1 = "+2";
+    }
+
+    if (knob_value_2 < 0.2f){
+        looper->play_speed_2 = 0.25f;
+        looper->volume_att_2 = 1.f;
+        mlooper_play_speed_string_2 = "-2";
+    } else if (knob_value_2 < 0.4f){
+        looper->play_speed_2 = 0.5f;
+        looper->volume_att_2 = 1.f;
+        mlooper_play_speed_string_2 = "-1";
+    } else if (knob_value_2 < 0.6f){
+        looper->play_speed_2 = 1.f;
+        looper->volume_att_2 = 1.f;
+        mlooper_play_speed_string_2 = " 0";
+    } else if (knob_value_2 < 0.8f){
+        looper->play_speed_2 = 2.f;
+        looper->volume_att_2 = 0.7f;
+        mlooper_play_speed_string_2 = "+1";
+    } else if (knob_value_2 > 0.8f){
+        looper->play_speed_2 = 4.f;
+        looper->volume_att_2 = 0.5f;
+        mlooper_play_speed_string_2 = "+2";
+    }
+};
+
+//where a play position of the loop is in the ring: the loop is the last len
+//samples before head, position writer_pos is its oldest one
+LoopPosition GetLooperPosition(int head, int writer_pos, int len, float pos) {
+    LoopPosition position;
+    int32_t pos_integral = static_cast<int32_t>(pos);
+    position.fractional = pos - static_cast<float>(pos_integral);
+    if (len <= 0) {
+        position.start = position.age = 0;
+        return position;
+    }
+    //age in the loop, 0 for the oldest sample. The positions stay within the loop, the
+    //division is only for the ones that don't
+    int age = pos_integral - writer_pos;
+    age += len & -static_cast<int>(age < 0);
+    if (age < 0 || age >= len) {
+        age = (age % len + len) % len;
+    }
+    position.age = age;
+    position.start = head - len;
+    position.start += LOOPER_MAX_SIZE & -static_cast<int>(position.start < 0);
+    return position;
+}
+//the sinc only where the others would alias, above speed 1, and as long as
+//the loop and its layers stay within the budget
+LoopQuality GetLooperQuality(float speed, int layers) {
+    if (fabsf(speed) > 1.f && LooperReader::Taps(LOOP_SINC, speed) * (layers + 1) <= LOOPER_TAP_BUDGET) {
+        return LOOP_SINC;
+    }
+    return LOOP_HERMITE;
+}
+void ProcessLooper(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{
+    if (params.looper.drywet > 0.98f) {
+        params.looper.drywet = 1.f;
+    }
+    mlooper_mixer.SetMix(params.looper.drywet, size);
+
+    stmlib::ParameterInterpolator att_1_ramp(&mlooper_previous_att_1, params.looper.volume_att_1, size);
+    stmlib::ParameterInterpolator att_2_ramp(&mlooper_previous_att_2, params.looper.volume_att_2, size);
+
+    if (mlooper_tap_time < LOOPER_MAX_LEN) {
+        mlooper_tap_time += size;
+    }
+
+    //automatic looptime
+    if (mlooper_len >= LOOPER_MAX_LEN)
+    {
+          mlooper_len   = LOOPER_MAX_LEN-1;
+    }
+
+    //the input is written and the play positions moved sample by sample, then
+    //each side is read a block at a time. The writer is always more than a
+    //loop ahead of the reads (and skips the frozen loop), so they don't see
+    //what was written in the same block
+    for (size_t start = 0; start < size; start += LOOPER_BLOCK_SIZE) {
+        size_t block = std::min(size - start, static_cast<size_t>(LOOPER_BLOCK_SIZE));
+        for (size_t i = 0; i < block; i++) {
+            mlooper_block_att_1[i] = att_1_ramp.Next();
+            mlooper_block_att_2[i] = att_2_ramp.Next();
+            //writing the incoming input into the buffer
+            WriteLooperBuffer(inl[start + i], inr[start + i]);
+            //advance the buffer writing cursor and wrap it if it's longer than the buffer length
+            mlooper_writer_pos++;
+            //before the first clock the length is still 0: the Cortex-M7 returned the
+            //dividend for % 0 (and then ran off the end of the buffer), wrap on the
+            //whole buffer instead so the host build doesn't trap
+            mlooper_writer_pos = (mlooper_writer_pos + mlooper_len) % (mlooper_len > 0 ? mlooper_len : LOOPER_MAX_LEN);
+            if (++mlooper_head >= LOOPER_MAX_SIZE) {
+                mlooper_head = 0;
+            }
+            if(mlooper_play) {
+                if(!mlooper_frozen) //if the looper is not frozen
+                {
+                    //now we change the play_pos according to the number of repetitions and the playing speed
+                    mlooper_pos_1 = mlooper_pos_1 + params.looper.play_speed_1;
+                    modified_buffer_length_l = (int)(mlooper_len * params.looper.division_1);
+                    if (mlooper_pos_1 > modified_buffer_length_l) {
+                        leds.PostForXCycles(0,10,1,0,0);
+                        mlooper_pos_1 = clamp(mlooper_pos_1 - modified_buffer_length_l, 0, mlooper_len);
+                    } else if (mlooper_pos_1<0.f){
+                        mlooper_pos_1 = clamp(mlooper_pos_1 + modified_buffer_length_l, 0, mlooper_len);
+                    }
+
+                    mlooper_pos_2 = mlooper_pos_2 + params.looper.play_speed_2;
+                    modified_buffer_length_r =  (int)(mlooper_len * params.looper.division_2);
+                    if (mlooper_pos_2 > modified_buffer_length_r) {
+                        leds.PostForXCycles(3,10,1,0,0);
+                        mlooper_pos_2 = clamp(mlooper_pos_2 - modified_buffer_length_r, 0, mlooper_len);
+                    } else if (mlooper_pos_2<0.f){
+                        mlooper_pos_2 = clamp(mlooper_pos_2 + modified_buffer_length_r, 0, mlooper_len);
+                    }
+
+                    mlooper_block_pos_1[i] = GetLooperPosition(mlooper_head,mlooper_writer_pos,mlooper_len,mlooper_pos_1);
+                    mlooper_block_pos_2[i] = GetLooperPosition(mlooper_head,mlooper_writer_pos,mlooper_len,mlooper_pos_2);
+                } else //Frozen Buffer
+                {
+                    //now we change the play_pos according to the number of repetitions and the playing speed
+                    mlooper_frozen_pos_1 = mlooper_frozen_pos_1 + params.looper.play_speed_1;
+                    modified_frozen_buffer_length_l =  (int)(mlooper_frozen_len * params.looper.division_1);
+                    if (mlooper_frozen_pos_1 > modified_frozen_buffer_length_l) {
+                        leds.PostForXCycles(0,10,0,0,1);
+                        mlooper_frozen_pos_1 = clamp(mlooper_frozen_pos_1 - modified_frozen_buffer_length_l, 0, mlooper_frozen_len) ;
+                    } else if (mlooper_frozen_pos_1<0.f){
+                        mlooper_frozen_pos_1 = clamp(mlooper_frozen_pos_1 + modified_frozen_buffer_length_l, 0, mlooper_frozen_len);
+                    }
+
+                    mlooper_frozen_pos_2 = mlooper_frozen_pos_2 + params.looper.play_speed_2;
+                    modified_frozen_buffer_length_r = (int)(mlooper_frozen_len * params.looper.division_2);
+                    if (mlooper_frozen_pos_2 > modified_frozen_buffer_length_r) {
+                        leds.PostForXCycles(3,10,0,0,1);
+                        mlooper_frozen_pos_2 = clamp(mlooper_frozen_pos_2 - modified_frozen_buffer_length_r, 0, mlooper_frozen_len) ;
+                    } else if (mlooper_frozen_pos_2<0.f){
+                        mlooper_frozen_pos_2 = clamp(mlooper_frozen_pos_2 + modified_frozen_buffer_length_r, 0, mlooper_frozen_len);
+                    }
+
+                    mlooper_block_pos_1[i] = GetLooperPosition(mlooper_frozen_head,mlooper_frozen_writer_pos,mlooper_frozen_len,mlooper_frozen_pos_1);
+                    mlooper_block_pos_2[i] = GetLooperPosition(mlooper_frozen_head,mlooper_frozen_writer_pos,mlooper_frozen_len,mlooper_frozen_pos_2);
+                };
+            }
+            //advance the counter for calculating the length of the next incoming buffer
+            mlooper_len_count++;
+        }
+
+        //the layers that play for the whole block, the newest one joins
+        //the next block once written
+        int layers = mlooper_frozen ? GetLooperPlayingLayers() : 0;
+        if (mlooper_play) {
+            int len = mlooper_frozen ? mlooper_frozen_len : mlooper_len;
+            mlooper_reader.Read(mlooper_buf_1l, mlooper_layer_l, layers, len, mlooper_block_pos_1, params.looper.play_speed_1,
+                                GetLooperQuality(params.looper.play_speed_1, layers), mlooper_block_out_1, block);
+            mlooper_reader.Read(mlooper_buf_1r, mlooper_layer_r, layers, len, mlooper_block_pos_2, params.looper.play_speed_2,
+                                GetLooperQuality(params.looper.play_speed_2, layers), mlooper_block_out_2, block);
+        }
+        //the layer is written after the reads, a playhead on its phase hears
+        //what was there before
+        bool write_layer = mlooper_layers > 0 && (mlooper_overdub || mlooper_layer_written < mlooper_frozen_len);
+        for (size_t i = 0; i < block; i++) {
+            if (write_layer) {
+                WriteLooperLayer(inl[start + i], inr[start + i]);
+            }
+            float out1l = mlooper_play ? mlooper_block_out_1[i] * mlooper_block_att_1[i] : 0.f;
+            float out1r = mlooper_play ? mlooper_block_out_2[i] * mlooper_block_att_2[i] : 0.f;
+            mlooper_mixer.Mix(inl[start + i], inr[start + i], out1l, out1r, outl[start + i], outr[start + i]);
+        }
+    }
+};
+
+
+void SelectDelayDivision(float new_delay_mult_l, float new_delay_mult_r) {
+    //crossfades to the new divisions when they change
+    //if (delay_time[delay_active] == -1){
+    //    delay_mult_l[delay_active] = new_delay_mult_l;
+    //    delay_mult_r[delay_active] = new_delay_mult_r;
+    //    };
+
+    if ((new_delay_mult_l != delay_mult_l[delay_active]) or (new_delay_mult_r != delay_mult_r[delay_active])) {
+
+        delay_mult_l[delay_inactive] = new_delay_mult_l;
+        delay_mult_r[delay_inactive] = new_delay_mult_r;
+
+        delay_xfade_target=delay_inactive;
+    }
+
+}
+
+void WriteDelayBuffer(float in_1l, float in_1r)
+{   
+    
+    delay_buf_l[delay_write_pos] = in_1l;
+    delay_buf_r[delay_write_pos] = in_1r;
+
+    //if frozen is active, stop writing to the frozen buffer
+    if(!delay_frozen) {
+        delay_frozen_buf_l[delay_write_pos] = in_1l;
+        delay_frozen_buf_r[delay_write_pos] = in_1r;    
+        delay_recorded += delay_recorded < DELAY_MAX_SIZE;
+    } 
+};
+
+void ProcessDelay(const float *inl, const float *inr, float *outl, float *outr, size_t size)
+{   
+    ReverbRamps rev_ramps(size);
+    if (params.delay.drywet > 0.99f) {
+         params.delay.drywet = 1.f ;
+    }
+    delay_mixer.SetMix(params.delay.drywet, size);
+    float delay_input_gain = clamp(1-params.delay.feedback,0.5,1);
+
+    stmlib::ParameterInterpolator input_gain_ramp(&delay_previous_input_gain, delay_input_gain, size);
+    stmlib::ParameterInterpolator feedback_ramp(&delay_previous_feedback, params.delay.feedback, size);
+
+    //the crossfade between the two delay lines moves a block at a time, the
+    //mixer ramps the gains over the block
+    if (delay_time[delay_inactive] > 0) {
+        float delay_xfade_step = size/(47.f*delay_control_latency_ms);
+        if (delay_xfade_current> delay_xfade_target) {
+            delay_xfade_current = clamp(delay_xfade_current - delay_xfade_step,0,1);
+        } else if (delay_xfade_current < delay_xfade_target){
+            delay_xfade_current = clamp(delay_xfade_current + delay_xfade_step, 0, 1);
+        } else {
+            delay_active = (int) delay_xfade_target ;
+            delay_inactive = (delay_active+1) % 2;
+            //delay_left_counter = delay_pos_l[delay_active] - delay_write_pos;
+            //delay_right_counter = delay_pos_r[delay_active] - delay_write_pos;
+        }
+    }
+    delay_xfade_mixer.SetMix(delay_xfade_current, size);
+
+    for (size_t i = 0; i < size; i++) {
+        float in1l = inl[i];
+        float in1r = inr[i];
+        float input_gain = input_gain_ramp.Next();
+        float feedback = feedback_ramp.Next();
+
+        delay_rmsCount++;
+        delay_rmsCount %= (RMS_SIZE);
+
+        if (delay_rmsCount == 0) {
+            delay_target_RMS = delay_averager.ProcessRMS();
+        }
+
+        fonepole(delay_feedback_RMS, delay_target_RMS, .001f *(1/(0.5+delay_feedback_RMS)) );
+        
+        fonepole(delay_fast_feedback_RMS, delay_target_RMS, .0005f *(1/(0.7+delay_fast_feedback_RMS)));
+
+        
+        float input_l = dcblock_2l.Process(delay_prev_sample_l*feedback*(1-delay_feedback_RMS*0.3) + in1l*input_gain)*(1-delay_fast_feedback_RMS*0.4);
+        float input_r = dcblock_2r.Process(delay_prev_sample_r*feedback*(1-delay_feedback_RMS*0.3) + in1r*input_gain)*(1-delay_fast_feedback_RMS*0.4);
+        
+
+        WriteDelayBuffer(input_l, input_r);
+        
+        if (delay_time[delay_inactive] > 0) {
+            if(!delay_frozen) {
+
+                delay_pos_l[0] =((int)((delay_write_pos - (delay_time[0]*delay_mult_l[0])) + DELAY_MAX_SIZE) )% DELAY_MAX_SIZE;
+                delay_pos_r[0] =((int)((delay_write_pos - (delay_time[0]*delay_mult_r[0])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+
+                delay_outl[0] = delay_buf_l[delay_pos_l[0]];
+                delay_outr[0] = delay_buf_r[delay_pos_r[0]];
+
+                delay_pos_l[1] =((int)((delay_write_pos - (delay_time[1]*delay_mult_l[1])) + DELAY_MAX_SIZE) )% DELAY_MAX_SIZE;
+                delay_pos_r[1] =((int)((delay_write_pos - (delay_time[1]*delay_mult_r[1])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+
+                delay_outl[1] = delay_buf_l[delay_pos_l[1]];
+                delay_outr[1] = delay_buf_r[delay_pos_r[1]];
+
+            }
+            else {
+                delay_pos_l[0] =((int)((delay_frozen_pos - (delay_time[0]*delay_mult_l[0])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+                delay_pos_r[0] =((int)((delay_frozen_pos - (delay_time[0]*delay_mult_r[0])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+
+                delay_outl[0] = delay_frozen_buf_l[delay_pos_l[0]];
+                delay_outr[0] = delay_frozen_buf_r[delay_pos_r[0]];
+
+                delay_pos_l[1] =((int)((delay_frozen_pos - (delay_time[1]*delay_mult_l[1])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+                delay_pos_r[1] =((int)((delay_frozen_pos - (delay_time[1]*delay_mult_r[1])) + DELAY_MAX_SIZE)) % DELAY_MAX_SIZE;
+
+                delay_outl[1] = delay_frozen_buf_l[delay_pos_l[1]];
+                delay_outr[1] = delay_frozen_buf_r[delay_pos_r[1]];
+
+                delay_frozen_pos++;
+                delay_frozen_pos = delay_frozen_pos % DELAY_MAX_SIZE;
+                if (delay_frozen_pos == delay_frozen_end) {
+                    delay_frozen_pos = delay_frozen_start;
+                    }
+                }
+            };
+
+   
+
+        //leds
+        delay_left_counter = (delay_left_counter -1);
+        if (delay_left_counter <=0) {
+        
+            if (delay_left_counter_4 == 0) {
+                leds.PostForXCycles(0, 3, 1*!delay_frozen,0,delay_frozen);
+            }
+            delay_left_counter_4 = (delay_left_counter_4 +1) % 4;
+            delay_left_counter = (delay_write_pos - delay_pos_l[delay_active]) / 4 ;
+        }
+        delay_right_counter = (delay_right_counter -1);
+        if (delay_right_counter <=0) {
+            if (delay_right_counter_4 == 0) {
+                leds.PostForXCycles(3, 3, 1*!delay_frozen ,0,delay_frozen);
+            }
+            delay_right_counter_4 = (delay_right_counter_4 +1) % 4;
+
+            delay_right_counter = (delay_write_pos - delay_pos_r[delay_active]) / 4;
+        }
+    
+
+        delay_time_count++; 
+        delay_write_pos++;
+        delay_write_pos = delay_write_pos % DELAY_MAX_SIZE;
+
+
+    
+    
+        float delay_outputl, delay_outputr;
+        delay_xfade_mixer.Mix(delay_outl[0], delay_outr[0], delay_outl[1], delay_outr[1], delay_outputl, delay_outputr);
+
+
+
+        delay_outputl = dcblock_l.Process(delay_outputl);
+        delay_outputr = dcblock_r.Process(delay_outputr);
+        delay_outputl = tonel.Process(delay_outputl);
+        delay_outputr = toner.Process(delay_outputr);
+        //float filter_out1l = svf2l.Process<stmlib::FILTER_MODE_LOW_PASS>(delay_out1l);
+        //float filter_out1r = svf2r.Process<stmlib::FILTER_MODE_LOW_PASS>(delay_out1r);
+
+
+        float reverb_outl, reverb_outr;
+        GetReverbSample(reverb_outl, reverb_outr, delay_outputl, delay_outputr, rev_ramps);
+        
+        delay_prev_sample_l = reverb_outl*0.85f;// + delay_outputl*0.1f;
+        delay_prev_sample_r = reverb_outr*0.85f; // + delay_outputr*0.1f;
+
+        delay_averager.Add((delay_prev_sample_l*delay_prev_sample_l + delay_prev_sample_r*delay_prev_sample_r)/2);
+
+        delay_mixer.Mix(in1l, in1r, delay_prev_sample_l, delay_prev_sample_r, outl[i], outr[i]);
+    }
+};
+
+void ProcessSpectra(const float *inl, const float *inr, float *outl, float *outr, size_t size) {
+    //snaps to full wet like the other modes (it used to creep up to 1 over a few samples)
+    if (params.spectra.drywet > 0.98f) {
+        params.spectra.drywet = 1.f;
+    }
+    spectra_mixer.SetMix(params.spectra.drywet, size);
+
+    for (size_t i = 0; i < size; i++) {
+        spectra_oscbank.updateFreqAndMagn();
+        float spectra_output = spectra_oscbank.Process();
+        //(sqrt(0.5f * (spectra_dynamics*2.0f))*filtered_out + sqrt(0.95f * (2.f - (spectra_dynamics*2))) * spectra_output)*0.5f;
+
+        float in_l = inl[i];
+        float in_r = inr[i];
+        spectra_mixer.Mix(in_l, in_r, spectra_output, spectra_output, outl[i], outr[i]);
+    }
+}
+
+void ProcessSpectrings(const float *inl, const float *inr, float *outl, float *outr, size_t size) {
+    if (params.spectrings.drywet > 0.98f) {
+        params.spectrings.drywet = 1.f;
+    }
+    spectrings_mixer.SetMix(params.spectrings.drywet, size);
+    //stereo spread of the two strings
+    float spectrings_width = 0.7 + (1-params.spectrings.pan_spread)*0.3;
+
+    for (size_t i = 0; i < size; i++) {
+        spectra_oscbank.updateFreqAndMagn();
+        float rings_1 = string_voice[0].Process()* (spectrings_accent_amount[0]*attack_lut[spectrings_attack_step[0]] + (1-spectrings_accent_amount[0]) );
+        float rings_2 = string_voice[1].Process()* (spectrings_accent_amount[1]*attack_lut[spectrings_attack_step[1]] + (1-spectrings_accent_amount[1]) );
+        //float rings_3 = string_voice[2].Process()* (spectrings_accent_amount[2]*spectrings_attack_lut[spectrings_attack_step[2]] + (1-spectrings_accent_amount[2]) );
+        //float rings_4 = string_voice[3].Process()* (spectrings_accent_amount[3]*spectrings_attack_lut[spectrings_attack_step[3]] + (1-spectrings_accent_amount[3]) );
+
+        float spectrings_outl = (rings_1 + rings_2 * params.spectrings.pan_spread)*spectrings_width;
+        float spectrings_outr = (rings_2 + rings_1 * params.spectrings.pan_spread)*spectrings_width;
+
+        spectrings_attack_step[0] = clamp(spectrings_attack_step[0]+1, 0, 299);
+        spectrings_attack_step[1] = clamp(spectrings_attack_step[1]+1, 0, 299);
+        //spectrings_attack_step[2] = clamp(spectrings_attack_step[2]+1, 0, 299);
+        //spectrings_attack_step[3] = clamp(spectrings_attack_step[3]+1, 0, 299);
+
+        float in_l = inl[i];
+        float in_r = inr[i];
+        spectrings_mixer.Mix(in_l, in_r, spectrings_outl, spectrings_outr, outl[i], outr[i]);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include "control_surface.h"
+#include "file_system.h"
+
+//Hardware independent part of MultiVersio: all the effects, the knob mapping
+//and the leds logic. The firmware (MultiEffect.cpp) and the host tools only
+//provide a ControlSurface, the audio buffers and possibly a FileSystem.
+
+#define REV 0
+#define RESONATOR 1
+#define FILTER 2
+#define LOFI 3
+#define MLOOPER 4
+#define DELAY 5
+#define SPECTRA 6
+#define SPECTRINGS 7
+#define NATURAL_GATE 8
+
+
+#define NUM_MODES 9
+
+extern const char *modes[NUM_MODES];
+
+extern int mode;
+
+//files is where the looper keeps its loop between two sessions, nullptr for
+//none
+void MultiEffectInit(float sample_rate, ControlSurface *control_surface, FileSystem *files = nullptr);
+
+//Control rate work, to be called from the main loop once per audio block
+//period: reads knobs, switches, tap and gate, maps them to the effect
+//parameters (parameters.h), publishes them to the audio callback and pushes
+//the leds.
+void MultiEffectControls();
+
+//Main loop work with no deadline, to be called as often as the main loop
+//can: the spectral analysis asked for by the gates. It returns at once when
+//there is nothing to do.
+void MultiEffectBackground();
+
+//The body of the audio callback: applies the latest controls and processes
+//one block of stereo audio.
+void MultiEffectProcess(float **in, float **out, size_t size);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//Everything the effects take from the front panel, already mapped to its
+//final range. MultiEffectControls fills one of these in the main loop and
+//publishes it in one go, the audio callback only ever reads a complete copy.
+//Only the structs of the current mode (and the reverb, for the modes that
+//chain it) are updated, the others keep their last values.
+
+struct ReverbParameters {
+    float drywet;
+    float feedback;
+    float lowpass;
+    float shimmer;
+    float compression;
+};
+
+struct ResonatorParameters {
+    float note;
+    int octave;
+    //filters cutoff, the tone filters are set an octave lower
+    float tone;
+    float feedback;
+    float drywet;
+    float glide;
+    int glide_mode;
+};
+
+struct FilterParameters {
+    //normalized cutoffs, already smoothed
+    float freq_l, freq_r;
+    float q_l, q_r;
+    float mode_l, mode_r;
+    //parallel (0) to serial (1)
+    float path;
+};
+
+struct LofiParameters {
+    float cutoff;
+    float depth;
+    //upper bound in samples of the time between two modulation changes
+    int mod;
+    float drywet;
+    float lpg_amount;
+    float lpg_decay;
+};
+
+struct LooperParameters {
+    bool freeze;
+    float division_1, division_2;
+    float play_speed_1, play_speed_2;
+    float volume_att_1, volume_att_2;
+    float drywet;
+    //taps so far, each one starts or stops an overdub layer (a count like
+    //gate_count, so that none is lost)
+    uint32_t tap_count;
+};
+
+struct DelayParameters {
+    bool freeze;
+    //divisions of the clock, taken when the delay time is updated
+    float mult_l, mult_r;
+    float feedback;
+    float drywet;
+    float cutoff;
+};
+
+//Spectra and Spectrings share the analysis
+struct SpectraParameters {
+    size_t hop;
+    int waveform;
+    int num_active;
+    float spread;
+    float lower_harmonics;
+    float oct_mult;
+    float drywet;
+    int transpose;
+    int quantize;
+    const bool *selected_scale;
+};
+
+struct SpectringsParameters {
+    float brightness;
+    float structure;
+    float damping;
+    float drywet;
+    float pan_spread;
+};
+
+struct EffectParameters {
+    int mode;
+    //the gate is a counter, so a trigger isn't lost if the main loop
+    //publishes more than once between two callbacks
+    uint32_t gate_count;
+
+    ReverbParameters reverb;
+    ResonatorParameters resonator;
+    FilterParameters filter;
+    LofiParameters lofi;
+    LooperParameters looper;
+    DelayParameters delay;
+    SpectraParameters spectra;
+    SpectringsParameters spectrings;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include "cycle_counter.h"
+#include "multi_effect.h"
+
+//Per-stage timing of the audio callback, only compiled in the profiling
+//build (ENABLE_PROFILER, "make PROFILE=1"). Each block is split in stages by
+//calling Mark() at the end of each of them; the stats are kept per mode.
+class CallbackProfiler {
+    public:
+    enum Stage {
+        STAGE_CONTROLS,
+        STAGE_ANALYSIS,
+        STAGE_AUDIO,
+        STAGE_TOTAL,
+        STAGE_LAST
+    };
+
+    struct Stats {
+        uint32_t min;
+        uint32_t max;
+        uint64_t sum;
+        uint32_t count;
+    };
+
+    CallbackProfiler() {
+        Reset();
+    };
+    ~CallbackProfiler() {};
+
+    void Init(float _sample_rate) {
+        sample_rate = _sample_rate;
+        ticks_per_second = CycleCounter::TicksPerSecond();
+        CycleCounter::Init();
+        Reset();
+    };
+
+    void Reset() {
+        for (int m = 0; m < NUM_MODES; m++) {
+            for (int s = 0; s < STAGE_LAST; s++) {
+                stats[m][s].min = UINT32_MAX;
+                stats[m][s].max = 0;
+                stats[m][s].sum = 0;
+                stats[m][s].count = 0;
+            }
+            overruns[m] = 0;
+            blocks[m] = 0;
+        }
+    };
+
+    inline void BeginBlock() {
+        block_start = last_mark = CycleCounter::Now();
+    };
+
+    //closes the stage that started at the previous mark
+    inline void Mark(Stage stage) {
+        uint32_t now = CycleCounter::Now();
+        stage_ticks[stage] = now - last_mark;
+        last_mark = now;
+    };
+
+    inline void EndBlock(int mode, size_t size) {
+        stage_ticks[STAGE_TOTAL] = CycleCounter::Now() - block_start;
+        uint32_t total = stage_ticks[STAGE_TOTAL];
+        for (int s = 0; s < STAGE_LAST; s++) {
+            Add(&stats[mode][s], stage_ticks[s]);
+            stage_ticks[s] = 0;
+        }
+        blocks[mode]++;
+        if (total > Budget(size)) {
+            overruns[mode]++;
+        }
+        last_size = size;
+    };
+
+    //ticks available to process a block before the next one is due
+    uint32_t Budget(size_t size) const {
+        return (uint32_t)((float)size / sample_rate * (float)ticks_per_second);
+    };
+
+    const Stats &Get(int mode, Stage stage) const {
+        return stats[mode][stage];
+    };
+    uint32_t Overruns(int mode) const {
+        return overruns[mode];
+    };
+
+    //One line per mode that ran and stage, in ticks (cycles on the Versio)
+    //and in tenths of percent of the block duration. Integers only, so it
+    //works with the nano printf.
+    void Dump(void (*print_line)(const char *)) const {
+        char line[128];
+        uint32_t budget = Budget(last_size);
+        const char *stage_names[STAGE_LAST] = {"controls", "analysis", "audio", "total"};
+        snprintf(line, sizeof(line), "block %u samples = %lu ticks", (unsigned)last_size, (unsigned long)budget);
+        print_line(line);
+        for (int m = 0; m < NUM_MODES; m++) {
+            if (blocks[m] == 0) {
+                continue;
+            }
+            snprintf(line, sizeof(line), "%s: %lu blocks, %lu overruns", modes[m], (unsigned long)blocks[m], (unsigned long)overruns[m]);
+            print_line(line);
+            for (int s = 0; s < STAGE_LAST; s++) {
+                const Stats &st = stats[m][s];
+                uint32_t avg = st.count ? (uint32_t)(st.sum / st.count) : 0;
+                uint32_t max_permille = budget ? (uint32_t)((uint64_t)st.max * 1000 / budget) : 0;
+                snprintf(line, sizeof(line), "  %-9s min %7lu avg %7lu max %7lu (%lu.%lu%%)", stage_names[s],
+                         (unsigned long)(st.count ? st.min : 0), (unsigned long)avg, (unsigned long)st.max,
+                         (unsigned long)(max_permille / 10), (unsigned long)(max_permille % 10));
+                print_line(line);
+            }
+        }
+    };
+
+    private:
+    Stats stats[NUM_MODES][STAGE_LAST];
+    uint32_t overruns[NUM_MODES];
+    uint32_t blocks[NUM_MODES];
+    uint32_t stage_ticks[STAGE_LAST] = {0};
+    uint32_t block_start = 0;
+    uint32_t last_mark = 0;
+    size_t last_size = 0;
+    float sample_rate = 48000.f;
+    uint32_t ticks_per_second = 1;
+
+    static void Add(Stats *st, uint32_t ticks) {
+        if (ticks < st->min) {
+            st->min = ticks;
+        }
+        if (ticks > st->max) {
+            st->max = ticks;
+        }
+        st->sum += ticks;
+        st->count++;
+    };
+};
+
+#ifdef ENABLE_PROFILER
+extern CallbackProfiler profiler;
+#define PROFILE_BEGIN() profiler.BeginBlock()
+#define PROFILE_MARK(stage) profiler.Mark(CallbackProfiler::stage)
+#define PROFILE_END(mode, size) profiler.EndBlock(mode, size)
+#else
+#define PROFILE_BEGIN()
+#define PROFILE_MARK(stage)
+#define PROFILE_END(mode, size)
+#endif
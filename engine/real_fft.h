@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "../shy_fft.h"
+#ifndef TEST
+#include "arm_math.h"
+#endif
+
+//Real FFTs of kSize points (a power of two), for the spectral analysis.
+//Direct() leaves the spectrum laid out as shy_fft does: the real parts of
+//bins 0 to kSize / 2 in output[0] to output[kSize / 2], then the imaginary
+//parts of bins 1 to kSize / 2 - 1, negated. Not scaled. The input is used
+//as scratch.
+//RealFft is the one the engine uses, chosen at compile time: CMSIS-DSP on
+//the Versio, shy_fft on the host (TEST) or with make SHY_FFT=1.
+
+//shy_fft, portable
+template <size_t kSize>
+class ShyRealFft {
+    ShyFFT<float, kSize, RotationPhasor> fft;
+
+    public:
+    ShyRealFft() {};
+    ~ShyRealFft() {};
+
+    static const char *Name() {
+        return "shy_fft";
+    };
+    void Init() {
+        fft.Init();
+    };
+    void Direct(float *input, float *output) {
+        fft.Direct(input, output);
+    };
+};
+
+#ifndef TEST
+//CMSIS-DSP's arm_rfft_fast_f32, written for the Cortex-M7. Its spectrum is
+//interleaved (the real parts of bins 0 and kSize / 2 first, then real and
+//imaginary of each bin), it goes to the layout above after the transform
+template <size_t kSize>
+class CmsisRealFft {
+    static_assert((kSize & (kSize - 1)) == 0 && kSize >= 32 && kSize <= 4096,
+                  "arm_rfft_fast_f32 has tables for 32 to 4096 points");
+
+    arm_rfft_fast_instance_f32 instance;
+    float interleaved[kSize];
+
+    public:
+    CmsisRealFft() {};
+    ~CmsisRealFft() {};
+
+    static const char *Name() {
+        return "arm_rfft_fast_f32";
+    };
+    void Init() {
+        arm_rfft_fast_init_f32(&instance, kSize);
+    };
+    void Direct(float *input, float *output) {
+        arm_rfft_fast_f32(&instance, input, interleaved, 0);
+        output[0] = interleaved[0];
+        output[kSize / 2] = interleaved[1];
+        for (size_t i = 1; i < kSize / 2; i++) {
+            output[i] = interleaved[2 * i];
+            output[kSize / 2 + i] = -interleaved[2 * i + 1];
+        }
+    };
+};
+#endif
+
+#if defined(TEST) || defined(SHY_FFT)
+template <size_t kSize>
+using RealFft = ShyRealFft<kSize>;
+#else
+template <size_t kSize>
+using RealFft = CmsisRealFft<kSize>;
+#endif
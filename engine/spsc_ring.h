@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Hands a stream of values from one writer to one reader without locks, e.g.
+//from the audio interrupt to the main loop. The writer fills Back() and
+//Push() hands it over, the reader takes Front() and Pop() gives the slot
+//back. Each side only writes its own index, so either one can interrupt the
+//other. Nothing waits: Back() is nullptr when the ring is full, Front() when
+//it is empty.
+template <typename T, size_t kSize>
+class SpscRing {
+    static_assert((kSize & (kSize - 1)) == 0, "the indexes wrap with a mask");
+
+    T slots[kSize];
+    //free running, the slots are at index & (kSize - 1)
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+
+    public:
+    SpscRing() : slots(), head(0), tail(0) {};
+    ~SpscRing() {};
+
+    //writer side
+    T *Back() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == kSize) {
+            return nullptr;
+        }
+        return &slots[h & (kSize - 1)];
+    };
+    void Push() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+
+    //reader side
+    const T *Front() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return nullptr;
+        }
+        return &slots[t & (kSize - 1)];
+    };
+    void Pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    };
+};
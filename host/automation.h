@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "host_control_surface.h"
+#include "../engine/multi_effect.h"
+
+//Timestamped control changes for the host tools. One event per line:
+//
+//  # seconds  command
+//  0.0    mode delay          (mode name or number, sets both switches)
+//  0.0    knob blend 0.5      (knob 0..6 or blend/speed/tone/index/regen/size/dense)
+//  0.0    sw 1 2              (switch 0..1, position 0..2)
+//  1.25   gate
+//  2.5    tap
+//
+//Events are applied before the block that contains their timestamp, like the
+//hardware only sees the controls once per audio callback.
+class Automation {
+    struct Event {
+        double time;
+        enum Type { KNOB, SWITCH, MODE, GATE, TAP } type;
+        int index;
+        float value;
+    };
+    std::vector<Event> events;
+    size_t next = 0;
+
+    public:
+    bool Load(const char *path) {
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            fprintf(stderr, "can't open %s\n", path);
+            return false;
+        }
+        char line[256];
+        int line_number = 0;
+        bool ok = true;
+        while (fgets(line, sizeof(line), f)) {
+            line_number++;
+            if (!Parse(line)) {
+                fprintf(stderr, "%s:%d: can't parse '%s'\n", path, line_number, strtok(line, "\r\n"));
+                ok = false;
+            }
+        }
+        fclose(f);
+        //events at the same time keep the order of the file
+        std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+            return a.time < b.time;
+        });
+        return ok;
+    };
+
+    //applies every event up to (and including) time
+    void Apply(double time, HostControlSurface *surface) {
+        while (next < events.size() && events[next].time <= time) {
+            const Event &e = events[next++];
+            switch (e.type) {
+                case Event::KNOB: surface->knobs[e.index] = e.value; break;
+                case Event::SWITCH: surface->switches[e.index] = (int)e.value; break;
+                case Event::MODE: surface->SelectMode(e.index); break;
+                case Event::GATE: surface->TriggerGate(); break;
+                case Event::TAP: surface->PressTap(); break;
+            }
+        }
+    };
+
+    void Rewind() {
+        next = 0;
+    };
+
+    private:
+    bool Parse(char *line) {
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char command[32], arg1[32];
+        float value;
+        double time;
+        int fields = sscanf(line, "%lf %31s %31s %f", &time, command, arg1, &value);
+        if (fields <= 0) {
+            //empty line
+            return true;
+        }
+        if (fields < 2 || time < 0) {
+            return false;
+        }
+        Event e = {time, Event::GATE, 0, 0.f};
+        if (!strcmp(command, "gate") && fields == 2) {
+            e.type = Event::GATE;
+        } else if (!strcmp(command, "tap") && fields == 2) {
+            e.type = Event::TAP;
+        } else if (!strcmp(command, "mode") && fields == 3) {
+            e.type = Event::MODE;
+            e.index = ModeIndex(arg1);
+            if (e.index < 0) {
+                return false;
+            }
+        } else if (!strcmp(command, "knob") && fields == 4) {
+            e.type = Event::KNOB;
+            e.index = KnobIndex(arg1);
+            e.value = std::min(std::max(value, 0.f), 1.f);
+            if (e.index < 0) {
+                return false;
+            }
+        } else if (!strcmp(command, "sw") && fields == 4) {
+            e.type = Event::SWITCH;
+            e.index = atoi(arg1);
+            e.value = value;
+            if (e.index < 0 || e.index >= ControlSurface::SW_LAST || value < 0 || value > 2) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        events.push_back(e);
+        return true;
+    };
+
+    public:
+    static int KnobIndex(const char *name) {
+        const char *names[ControlSurface::KNOB_LAST] = {"blend", "speed", "tone", "index", "regen", "size", "dense"};
+        for (int i = 0; i < ControlSurface::KNOB_LAST; i++) {
+            if (!strcmp(name, names[i])) {
+                return i;
+            }
+        }
+        char *end;
+        long index = strtol(name, &end, 10);
+        return (*end == '\0' && index >= 0 && index < ControlSurface::KNOB_LAST) ? (int)index : -1;
+    };
+
+    //accepts the mode number or its name, case insensitive and without spaces/dashes
+    static int ModeIndex(const char *name) {
+        const char *short_names[NUM_MODES] = {"rev", "resonator", "filter", "lofi", "mlooper", "delay", "spectra", "spectrings", "naturalgate"};
+        std::string simplified;
+        for (const char *c = name; *c; c++) {
+            if (*c != '-' && *c != '_' && *c != ' ') {
+                simplified += (char)tolower(*c);
+            }
+        }
+        for (int i = 0; i < NUM_MODES; i++) {
+            std::string full;
+            for (const char *c = modes[i]; *c; c++) {
+                if (*c != '-' && *c != ' ') {
+                    full += (char)tolower(*c);
+                }
+            }
+            if (simplified == short_names[i] || simplified == full) {
+                return i;
+            }
+        }
+        char *end;
+        long index = strtol(name, &end, 10);
+        return (*end == '\0' && index >= 0 && index < NUM_MODES) ? (int)index : -1;
+    };
+};
@@ -0,0 +1,432 @@
+//Per-mode CPU benchmark. Runs the audio callback processing of every mode
+//(the chained ones included: LO-FI is reverb+lofi, Spectra oscbank+reverb,
+//Spectrings strings+reverb) at fixed block sizes and reports the cost per
+//sample and the share of the 48 kHz real-time budget it takes.
+//The MicroLooper is also timed with 4 and 8 overdub layers.
+//Then a few kernels are timed on their own, next to what they replaced, and
+//the 1024 point FFT of the spectral analysis: time per transform and error
+//against a reference DFT.
+//On the Versio (480 MHz) a sample lasts 10000 cycles, so with -s each 1% of
+//budget is 100 cycles per sample.
+//
+//  bench [-b 16,48,128] [-t seconds] [-s scale] [-o baseline.txt] [-c baseline.txt] [-r percent]
+//
+//  -s scale   multiplies the host timings, e.g. the measured ratio between
+//             this machine and the Versio, to estimate the on-device budget
+//  -o file    writes the results as the new baseline
+//  -c file    compares with a baseline, exits with 1 if anything got slower
+//             than the tolerance given with -r (default 10%). With -s a
+//             block that overruns its real-time budget fails too (without
+//             it the worst block is mostly the host scheduler)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "daisysp.h"
+#include "host_control_surface.h"
+#include "test_signal.h"
+#include "../dsp/block_reverb.h"
+#include "../dsp/loop_reader.h"
+#include "../dsp/sample_storage.h"
+#include "../engine/fft_bench.h"
+#include "../engine/multi_effect.h"
+#include "../engine/real_fft.h"
+
+#define SAMPLE_RATE 48000.f
+#define MAX_BLOCK_SIZE 256
+#define REPEATS 3
+
+struct BenchResult {
+    std::string name;
+    double ns_per_sample;
+    //worst single block, in percent of the time the block lasts
+    double worst_block_percent;
+};
+
+static HostControlSurface control_surface;
+static TestSignal test_signal;
+
+static double BudgetPercent(double ns_per_sample)
+{
+    return ns_per_sample * SAMPLE_RATE / 1e9 * 100.0;
+}
+
+static BenchResult BenchMode(int m, size_t block_size, float seconds, double scale)
+{
+    float in_l[MAX_BLOCK_SIZE], in_r[MAX_BLOCK_SIZE];
+    float out_l[MAX_BLOCK_SIZE], out_r[MAX_BLOCK_SIZE];
+    float *in[2] = {in_l, in_r};
+    float *out[2] = {out_l, out_r};
+
+    control_surface.SelectMode(m);
+    size_t num_blocks = (size_t)(seconds * SAMPLE_RATE / block_size);
+    size_t gate_period = (size_t)(SAMPLE_RATE / block_size / 2);
+    double block_ns = block_size * 1e9 / SAMPLE_RATE;
+
+    double best_total = 1e30;
+    double worst_block = 0.0;
+    //the first round is a warm up that lets the mode settle (and the
+    //caches fill), then the fastest round is kept as it has the least noise
+    for (int r = 0; r <= REPEATS; r++) {
+        double total = 0.0;
+        for (size_t b = 0; b < num_blocks; b++) {
+            //a gate every half second keeps the loopers and the analysis busy
+            if (b % gate_period == 0) {
+                control_surface.TriggerGate();
+            }
+            test_signal.Render(in_l, in_r, block_size);
+            //the main loop work, not part of the callback budget
+            MultiEffectBackground();
+            MultiEffectControls();
+            auto begin = std::chrono::steady_clock::now();
+            MultiEffectProcess(in, out, block_size);
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - begin).count() * scale;
+            total += ns;
+            if (r > 0) {
+                worst_block = std::max(worst_block, ns);
+            }
+        }
+        if (r > 0) {
+            best_total = std::min(best_total, total);
+        }
+    }
+
+    BenchResult result;
+    char name[64];
+    snprintf(name, sizeof(name), "mode/%d/%u", m, (unsigned)block_size);
+    result.name = name;
+    result.ns_per_sample = best_total / (num_blocks * block_size);
+    result.worst_block_percent = worst_block / block_ns * 100.0;
+    return result;
+}
+
+//runs the engine outside of the timings, to get a mode where it has to be
+static void Run(float seconds, size_t block_size)
+{
+    float in_l[MAX_BLOCK_SIZE], in_r[MAX_BLOCK_SIZE];
+    float out_l[MAX_BLOCK_SIZE], out_r[MAX_BLOCK_SIZE];
+    float *in[2] = {in_l, in_r};
+    float *out[2] = {out_l, out_r};
+
+    size_t num_blocks = (size_t)(seconds * SAMPLE_RATE / block_size);
+    for (size_t b = 0; b < num_blocks; b++) {
+        test_signal.Render(in_l, in_r, block_size);
+        MultiEffectBackground();
+        MultiEffectControls();
+        MultiEffectProcess(in, out, block_size);
+    }
+}
+
+//The MicroLooper frozen on a 1 second loop with overdub layers, both
+//playheads two octaves up: the most the reads can cost
+static BenchResult BenchLooperLayers(int layers, size_t block_size, float seconds, double scale)
+{
+    control_surface.SelectMode(MLOOPER);
+    control_surface.knobs[ControlSurface::KNOB_1] = 0.95f;
+    control_surface.knobs[ControlSurface::KNOB_5] = 0.95f;
+    control_surface.TriggerGate();
+    Run(1.f, block_size);
+    control_surface.TriggerGate();
+    Run(0.1f, block_size);
+    control_surface.knobs[ControlSurface::KNOB_3] = 0.9f;
+    for (int l = 0; l < layers; l++) {
+        //more than a pass, and far enough from the other taps not to be
+        //double taps
+        control_surface.PressTap();
+        Run(1.2f, block_size);
+        control_surface.PressTap();
+        Run(0.5f, block_size);
+    }
+
+    BenchResult result = BenchMode(MLOOPER, block_size, seconds, scale);
+    char name[64];
+    snprintf(name, sizeof(name), "layers/%d/%u", layers, (unsigned)block_size);
+    result.name = name;
+
+    //unfrozen, the layers go
+    control_surface.knobs[ControlSurface::KNOB_1] = 0.5f;
+    control_surface.knobs[ControlSurface::KNOB_3] = 0.5f;
+    control_surface.knobs[ControlSurface::KNOB_5] = 0.5f;
+    Run(0.1f, block_size);
+    return result;
+}
+
+//A kernel processes a stereo block, Init resets it before each run
+struct Kernel {
+    const char *name;
+    void (*Init)();
+    void (*Process)(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size);
+};
+
+static daisysp::ReverbSc reverb_sc;
+static BlockReverb block_reverb;
+
+static void InitReverbSc()
+{
+    reverb_sc.Init(SAMPLE_RATE);
+    reverb_sc.SetFeedback(0.85f);
+    reverb_sc.SetLpFreq(9000.f);
+}
+
+//the per sample call the modes used to make
+static void ProcessReverbSc(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        reverb_sc.Process(in_l[i], in_r[i], &out_l[i], &out_r[i]);
+    }
+}
+
+static void InitBlockReverb()
+{
+    block_reverb.Init(SAMPLE_RATE);
+    block_reverb.SetFeedback(0.85f);
+    block_reverb.SetLpFreq(9000.f);
+}
+
+static void ProcessBlockReverb(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size)
+{
+    block_reverb.Process(in_l, in_r, out_l, out_r, size);
+}
+
+//as the delay and the resonator run it
+static void ProcessBlockReverbSample(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        block_reverb.Process(in_l[i], in_r[i], &out_l[i], &out_r[i]);
+    }
+}
+
+//the looper's reads, both sides of a 1 second loop in a 16 bit ring that
+//doesn't fit in the caches
+#define LOOP_RING_SIZE (1 << 20)
+#define LOOP_LEN 48000
+
+static LoopReader<S16Storage, LOOP_RING_SIZE> loop_reader;
+static int16_t loop_ring_l[LOOP_RING_SIZE], loop_ring_r[LOOP_RING_SIZE];
+static float loop_pos;
+
+static void InitLoopReader()
+{
+    float l[MAX_BLOCK_SIZE], r[MAX_BLOCK_SIZE];
+    for (size_t i = 0; i < LOOP_RING_SIZE; i += MAX_BLOCK_SIZE) {
+        test_signal.Render(l, r, MAX_BLOCK_SIZE);
+        for (size_t j = 0; j < MAX_BLOCK_SIZE; j++) {
+            loop_ring_l[i + j] = S16Storage::Pack(l[j]);
+            loop_ring_r[i + j] = S16Storage::Pack(r[j]);
+        }
+    }
+    loop_reader.Init();
+    //between two samples, so that every quality interpolates
+    loop_pos = 0.5f;
+}
+
+template <LoopQuality quality, int speed>
+static void ProcessLoopReader(const float *in_l, const float *in_r, float *out_l, float *out_r, size_t size)
+{
+    LoopPosition positions[MAX_BLOCK_SIZE];
+    for (size_t i = 0; i < size; i++) {
+        loop_pos += speed;
+        if (loop_pos >= LOOP_LEN) {
+            loop_pos -= LOOP_LEN;
+        }
+        positions[i].start = LOOP_RING_SIZE - LOOP_LEN / 2;
+        positions[i].age = static_cast<int>(loop_pos);
+        positions[i].fractional = loop_pos - positions[i].age;
+    }
+    loop_reader.Read(loop_ring_l, nullptr, 0, LOOP_LEN, positions, speed, quality, out_l, size);
+    loop_reader.Read(loop_ring_r, nullptr, 0, LOOP_LEN, positions, speed, quality, out_r, size);
+}
+
+//the size of the spectral analysis
+#define FFT_POINTS 1024
+
+static FftBench<ShyRealFft<FFT_POINTS>, FFT_POINTS> fft_bench;
+
+static const Kernel kernels[] = {
+    {"reverb_sc", InitReverbSc, ProcessReverbSc},
+    {"block_reverb", InitBlockReverb, ProcessBlockReverb},
+    {"block_reverb_sample", InitBlockReverb, ProcessBlockReverbSample},
+    {"looper_linear", InitLoopReader, ProcessLoopReader<LOOP_LINEAR, 1>},
+    {"looper_hermite", InitLoopReader, ProcessLoopReader<LOOP_HERMITE, 1>},
+    {"looper_sinc", InitLoopReader, ProcessLoopReader<LOOP_SINC, 1>},
+    {"looper_linear_x4", InitLoopReader, ProcessLoopReader<LOOP_LINEAR, 4>},
+    {"looper_sinc_x2", InitLoopReader, ProcessLoopReader<LOOP_SINC, 2>},
+    {"looper_sinc_x4", InitLoopReader, ProcessLoopReader<LOOP_SINC, 4>},
+};
+
+static BenchResult BenchKernel(const Kernel &kernel, size_t block_size, float seconds, double scale)
+{
+    float in_l[MAX_BLOCK_SIZE], in_r[MAX_BLOCK_SIZE];
+    float out_l[MAX_BLOCK_SIZE], out_r[MAX_BLOCK_SIZE];
+
+    size_t num_blocks = (size_t)(seconds * SAMPLE_RATE / block_size);
+    double block_ns = block_size * 1e9 / SAMPLE_RATE;
+
+    double best_total = 1e30;
+    double worst_block = 0.0;
+    kernel.Init();
+    for (int r = 0; r <= REPEATS; r++) {
+        double total = 0.0;
+        for (size_t b = 0; b < num_blocks; b++) {
+            test_signal.Render(in_l, in_r, block_size);
+            auto begin = std::chrono::steady_clock::now();
+            kernel.Process(in_l, in_r, out_l, out_r, block_size);
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - begin).count() * scale;
+            total += ns;
+            if (r > 0) {
+                worst_block = std::max(worst_block, ns);
+            }
+        }
+        if (r > 0) {
+            best_total = std::min(best_total, total);
+        }
+    }
+
+    BenchResult result;
+    char name[64];
+    snprintf(name, sizeof(name), "kernel/%s/%u", kernel.name, (unsigned)block_size);
+    result.name = name;
+    result.ns_per_sample = best_total / (num_blocks * block_size);
+    result.worst_block_percent = worst_block / block_ns * 100.0;
+    return result;
+}
+
+static bool LoadBaseline(const char *path, std::map<std::string, double> *baseline)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char name[64];
+    double value;
+    while (fscanf(f, "%63s %lf", name, &value) == 2) {
+        (*baseline)[name] = value;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool SaveBaseline(const char *path, const std::vector<BenchResult> &results)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    for (const BenchResult &r : results) {
+        fprintf(f, "%s %.3f\n", r.name.c_str(), r.ns_per_sample);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<size_t> block_sizes = {16, 48, 128};
+    float seconds = 2.f;
+    double scale = 1.0;
+    double tolerance = 10.0;
+    const char *save_path = nullptr;
+    const char *compare_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "-b") && has_value) {
+            block_sizes.clear();
+            for (char *s = strtok(argv[++i], ","); s; s = strtok(nullptr, ",")) {
+                size_t size = atoi(s);
+                if (size < 1 || size > MAX_BLOCK_SIZE) {
+                    fprintf(stderr, "block sizes go from 1 to %d\n", MAX_BLOCK_SIZE);
+                    return 1;
+                }
+                block_sizes.push_back(size);
+            }
+        } else if (!strcmp(argv[i], "-t") && has_value) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && has_value) {
+            scale = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && has_value) {
+            tolerance = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-o") && has_value) {
+            save_path = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && has_value) {
+            compare_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: bench [-b 16,48,128] [-t seconds] [-s scale] [-o baseline] [-c baseline] [-r percent]\n");
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (compare_path && !LoadBaseline(compare_path, &baseline)) {
+        fprintf(stderr, "can't read %s\n", compare_path);
+        return 1;
+    }
+
+    MultiEffectInit(SAMPLE_RATE, &control_surface);
+    test_signal.Init(SAMPLE_RATE);
+    for (int i = 0; i < ControlSurface::KNOB_LAST; i++) {
+        control_surface.knobs[i] = 0.5f;
+    }
+
+    std::vector<BenchResult> results;
+    bool failed = false;
+    printf("%-20s %6s %10s %9s %11s  %s\n", "mode", "block", "ns/sample", "budget", "worst block", compare_path ? "vs baseline" : "");
+    auto report = [&](const char *label, size_t block_size, const BenchResult &r) {
+        results.push_back(r);
+
+        std::string verdict;
+        if (r.worst_block_percent > 100.0) {
+            verdict = "OVERRUN ";
+            failed = failed || (compare_path != nullptr && scale != 1.0);
+        }
+        auto it = baseline.find(r.name);
+        if (it != baseline.end() && it->second > 0.0) {
+            double change = (r.ns_per_sample / it->second - 1.0) * 100.0;
+            char text[48];
+            snprintf(text, sizeof(text), "%+6.1f%%", change);
+            verdict += text;
+            if (change > tolerance) {
+                verdict += " REGRESSION";
+                failed = true;
+            }
+        }
+        printf("%-20s %6u %10.1f %8.2f%% %10.1f%%  %s\n", label, (unsigned)block_size,
+               r.ns_per_sample, BudgetPercent(r.ns_per_sample), r.worst_block_percent, verdict.c_str());
+    };
+    for (int m = 0; m < NUM_MODES; m++) {
+        for (size_t block_size : block_sizes) {
+            report(modes[m], block_size, BenchMode(m, block_size, seconds, scale));
+        }
+    }
+    for (int layers : {4, 8}) {
+        char label[32];
+        snprintf(label, sizeof(label), "Looper %d layers", layers);
+        for (size_t block_size : block_sizes) {
+            report(label, block_size, BenchLooperLayers(layers, block_size, seconds, scale));
+        }
+    }
+    for (const Kernel &kernel : kernels) {
+        for (size_t block_size : block_sizes) {
+            report(kernel.name, block_size, BenchKernel(kernel, block_size, seconds, scale));
+        }
+    }
+    //main loop work, the callback doesn't wait for it. The profiler build of
+    //the firmware prints the same for arm_rfft_fast_f32 and shy_fft, in cycles
+    fft_bench.Init();
+    FftBenchResult fft = fft_bench.Run(1000);
+    printf("\n%-20s %6s %10s %9s\n", "fft", "points", "ns", "error");
+    printf("%-20s %6u %10.1f %7.1fdB\n", ShyRealFft<FFT_POINTS>::Name(), FFT_POINTS, fft.ticks * scale, fft.error_db);
+
+    if (save_path && !SaveBaseline(save_path, results)) {
+        fprintf(stderr, "can't write %s\n", save_path);
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
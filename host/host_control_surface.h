@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../engine/control_surface.h"
+
+//Front panel stand-in for the host build: knobs, switches, tap and gate are
+//plain values set by the host program, leds are just stored.
+class HostControlSurface : public ControlSurface {
+    public:
+    float knobs[KNOB_LAST];
+    int switches[SW_LAST];
+    float leds[4][3];
+    size_t led_updates = 0;
+
+    HostControlSurface() {
+        for (int i = 0; i < KNOB_LAST; i++) {
+            knobs[i] = 0.f;
+        }
+        //middle position of both switches is REV
+        switches[SW_0] = 1;
+        switches[SW_1] = 1;
+        for (int i = 0; i < 4; i++) {
+            leds[i][0] = leds[i][1] = leds[i][2] = 0.f;
+        }
+    };
+
+    //Switch positions for a mode, inverse of the mapping in UpdateKnobs
+    void SelectMode(int mode) {
+        const int sw0_for_column[3] = {1, 0, 2};
+        const int sw1_for_row[3] = {1, 0, 2};
+        switches[SW_0] = sw0_for_column[mode % 3];
+        switches[SW_1] = sw1_for_row[mode / 3];
+    };
+
+    //the gate trigger is seen by the next control cycle
+    void TriggerGate() {
+        gate_pending = true;
+    };
+    //like the switch debounce, the edge shows up after the next debounce
+    void PressTap() {
+        tap_pending = true;
+    };
+
+    void ProcessAnalogControls() override {};
+    float GetKnobValue(int idx) override {
+        return knobs[idx];
+    };
+    int ReadSwitch(int idx) override {
+        return switches[idx];
+    };
+    bool TapRisingEdge() override {
+        return tap_rising;
+    };
+    void DebounceTap() override {
+        tap_rising = tap_pending;
+        tap_pending = false;
+    };
+    bool GateTrig() override {
+        bool trig = gate_pending;
+        gate_pending = false;
+        return trig;
+    };
+    void SetLed(size_t idx, float r, float g, float b) override {
+        leds[idx][0] = r;
+        leds[idx][1] = g;
+        leds[idx][2] = b;
+    };
+    void UpdateLeds() override {
+        led_updates++;
+    };
+
+    private:
+    bool gate_pending = false;
+    bool tap_pending = false;
+    bool tap_rising = false;
+};
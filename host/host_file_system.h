@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include "../engine/file_system.h"
+
+//File system stand-in for the host build: the files are in a directory of
+//the host, through stdio.
+class HostFileSystem : public FileSystem {
+    std::string dir;
+    FILE *file = nullptr;
+
+    std::string Path(const char *name) const {
+        return dir + "/" + name;
+    };
+
+    public:
+    explicit HostFileSystem(const char *_dir) : dir(_dir) {};
+    ~HostFileSystem() {
+        Close();
+    };
+
+    bool Open(const char *name, bool write) override {
+        Close();
+        file = fopen(Path(name).c_str(), write ? "wb" : "rb");
+        return file != nullptr;
+    };
+    bool Read(void *data, size_t size) override {
+        return file && fread(data, 1, size, file) == size;
+    };
+    bool Write(const void *data, size_t size) override {
+        return file && fwrite(data, 1, size, file) == size;
+    };
+    bool Seek(size_t offset) override {
+        return file && fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+    };
+    void Close() override {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    };
+    bool Rename(const char *from, const char *to) override {
+        return rename(Path(from).c_str(), Path(to).c_str()) == 0;
+    };
+};
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+# Memory report of the firmware, from the map file written by the linker.
+# Prints how full each memory region is and the biggest buffers in it, then
+# checks the buffers listed in the memory plan against where they ended up:
+# it exits with 1 if one of them is missing or in another region (a hot
+# buffer in the SDRAM, a big one that spilled into the SRAM).
+#
+#   memory_report.py [-p engine/memory_plan.txt] [-n 8] build/MultiEffect.map
+
+import argparse
+import re
+import sys
+
+HEX = r'0x[0-9a-fA-F]+'
+
+
+# sections that take no memory on the target
+NOT_LOADED = re.compile(r'\.(debug|comment|stab|ARM\.attributes|gnu)')
+
+
+def demangle(name):
+    # only what the map has for the data symbols: _ZL3rev, _ZN5daisyL4sdmmcE,
+    # anything else is left as it is
+    m = re.match(r'_Z(N?)L?((?:L?\d+\w*?)+?)(E?)(?:B\d+\w+)?$', name)
+    if not m or (m.group(1) == 'N') != (m.group(3) == 'E'):
+        return name
+    parts = []
+    rest = m.group(2)
+    while rest:
+        n = re.match(r'L?(\d+)', rest)
+        if not n:
+            return name
+        length = int(n.group(1))
+        start = n.end()
+        if start + length > len(rest):
+            return name
+        parts.append(rest[start:start + length])
+        rest = rest[start + length:]
+    return '::'.join(parts)
+
+
+def add_input_section(symbols, section, input_section, address, size):
+    input_section['address'] = address
+    input_section['size'] = size
+    # -fdata-sections gives each variable its own input section, named after it
+    parts = input_section['name'].split('.')
+    if len(parts) > 2 and size > 0:
+        symbols.append({'name': demangle(parts[-1]), 'address': address, 'size': size,
+                        'section': section['name'], 'end': address + size})
+
+
+def parse_map(path):
+    regions = []
+    sections = []
+    symbols = []
+    with open(path) as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    while i < len(lines) and lines[i].strip() != 'Memory Configuration':
+        i += 1
+    for line in lines[i + 1:]:
+        if line.startswith('Linker script and memory map'):
+            break
+        m = re.match(r'(\S+)\s+(' + HEX + r')\s+(' + HEX + r')', line)
+        if m and m.group(1) != '*default*':
+            regions.append({'name': m.group(1), 'origin': int(m.group(2), 16),
+                            'length': int(m.group(3), 16), 'used': 0})
+
+    section = None
+    input_section = None
+    pending = None
+    for line in lines[i:]:
+        # output section, its address and size can be on the next line
+        m = re.match(r'(\.[\w.]+)\s*(?:(' + HEX + r')\s+(' + HEX + r'))?(?:\s+load address (' + HEX + r'))?', line)
+        if m and not line.startswith(' '):
+            section = {'name': m.group(1), 'address': None, 'size': 0, 'load': None}
+            sections.append(section)
+            input_section = None
+            if m.group(2):
+                section['address'] = int(m.group(2), 16)
+                section['size'] = int(m.group(3), 16)
+                section['load'] = int(m.group(4), 16) if m.group(4) else None
+                pending = None
+            else:
+                pending = section
+            continue
+        if pending is not None:
+            m = re.match(r'\s+(' + HEX + r')\s+(' + HEX + r')(?:\s+load address (' + HEX + r'))?', line)
+            if m:
+                pending['address'] = int(m.group(1), 16)
+                pending['size'] = int(m.group(2), 16)
+                pending['load'] = int(m.group(3), 16) if m.group(3) else None
+            pending = None
+            continue
+        if section is None:
+            continue
+
+        # input section: " .bss._ZL3rev  0x... 0x... object", the name alone
+        # on its line when it is long
+        m = re.match(r' (\.[\w.$]+)(?:\s+(' + HEX + r')\s+(' + HEX + r')\s+\S.*)?$', line)
+        if m:
+            input_section = {'name': m.group(1), 'address': None, 'size': 0}
+            if m.group(2):
+                add_input_section(symbols, section, input_section, int(m.group(2), 16), int(m.group(3), 16))
+            continue
+        m = re.match(r'\s+(' + HEX + r')\s+(' + HEX + r')\s+\S.*$', line)
+        if m and input_section is not None and input_section['address'] is None:
+            add_input_section(symbols, section, input_section, int(m.group(1), 16), int(m.group(2), 16))
+            continue
+
+        # symbol defined in the current input section
+        m = re.match(r'\s+(' + HEX + r')\s+([A-Za-z_][\w:\[\]]*)\s*$', line)
+        if m and input_section is not None and input_section['address'] is not None:
+            symbol = {'name': m.group(2).split('[')[0], 'address': int(m.group(1), 16), 'size': None,
+                      'section': section['name'], 'end': input_section['address'] + input_section['size']}
+            symbols.append(symbol)
+
+    # sizes of the symbols that share an input section: up to the next one
+    named = [s for s in symbols if s['size'] is None]
+    named.sort(key=lambda s: s['address'])
+    for n, s in enumerate(named):
+        end = s['end']
+        for other in named[n + 1:]:
+            if other['address'] > s['address'] and other['end'] == s['end']:
+                end = other['address']
+                break
+        s['size'] = end - s['address']
+
+    # the same variable can be seen both as an input section and a symbol
+    unique = {}
+    for s in symbols:
+        key = (s['name'], s['address'])
+        if key not in unique or s['size'] > unique[key]['size']:
+            unique[key] = s
+    return regions, sections, list(unique.values())
+
+
+def region_of(regions, address):
+    for r in regions:
+        if r['origin'] <= address < r['origin'] + r['length']:
+            return r
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='memory report of the firmware map file')
+    parser.add_argument('map')
+    parser.add_argument('-p', '--plan', help='symbols and the region they have to be in')
+    parser.add_argument('-n', '--top', type=int, default=8, help='biggest buffers listed per region')
+    args = parser.parse_args()
+
+    regions, sections, symbols = parse_map(args.map)
+    if not regions:
+        print('%s: no memory configuration, is it a map file?' % args.map, file=sys.stderr)
+        return 1
+
+    for s in sections:
+        if s['address'] is None or s['size'] == 0 or NOT_LOADED.match(s['name']):
+            continue
+        r = region_of(regions, s['address'])
+        if r:
+            r['used'] += s['size']
+        # initialized data is copied from the flash at startup
+        if s['load'] is not None and s['load'] != s['address'] and 'bss' not in s['name']:
+            r = region_of(regions, s['load'])
+            if r:
+                r['used'] += s['size']
+
+    for s in symbols:
+        r = region_of(regions, s['address'])
+        s['region'] = r['name'] if r else None
+
+    print('%-12s %12s %12s %7s' % ('region', 'used', 'size', ''))
+    for r in regions:
+        if r['used'] == 0:
+            continue
+        print('%-12s %12d %12d %6.1f%%' % (r['name'], r['used'], r['length'], r['used'] * 100.0 / r['length']))
+        data = [s for s in symbols if s['region'] == r['name'] and not s['section'].startswith('.text')
+                and not NOT_LOADED.match(s['section'])]
+        data.sort(key=lambda s: -s['size'])
+        for s in data[:args.top]:
+            print('    %-32s %12d  %s' % (s['name'], s['size'], s['section']))
+
+    if not args.plan:
+        return 0
+
+    failed = False
+    by_name = {}
+    for s in symbols:
+        by_name.setdefault(s['name'], []).append(s)
+    print()
+    with open(args.plan) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split('#')[0].split()
+            if not line:
+                continue
+            if len(line) != 2:
+                print('%s:%d: expected a symbol and a region' % (args.plan, number), file=sys.stderr)
+                return 1
+            name, planned = line
+            if not any(r['name'] == planned for r in regions):
+                print('%s:%d: no %s region in the map' % (args.plan, number, planned), file=sys.stderr)
+                return 1
+            found = by_name.get(name)
+            if not found:
+                print('MISSING  %-24s not in the map (static in a shared section?)' % name)
+                failed = True
+                continue
+            actual = found[0]['region']
+            if actual == planned:
+                print('ok       %-24s %s' % (name, actual))
+            elif actual == 'SDRAM':
+                print('FAIL     %-24s hot buffer in the SDRAM, planned in %s' % (name, planned))
+                failed = True
+            else:
+                print('FAIL     %-24s in %s, planned in %s' % (name, actual, planned))
+                failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,148 @@
+//Offline renderer: runs the same processing as the audio callback over a WAV
+//file, optionally driven by an automation script (see automation.h), and
+//reports the throughput of each mode.
+//
+//  render [-m mode] [-a script] [-b block_size] [-t tail_seconds] [-l dir] [-16] in.wav out.wav
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "automation.h"
+#include "host_control_surface.h"
+#include "host_file_system.h"
+#include "wav_file.h"
+#include "../engine/multi_effect.h"
+
+#define MAX_BLOCK_SIZE 256
+
+static HostControlSurface control_surface;
+
+static void Usage()
+{
+    fprintf(stderr,
+            "usage: render [-m mode] [-a script] [-b block_size] [-t tail_seconds] [-l dir] [-16] in.wav out.wav\n"
+            "  -m mode     initial mode, name or number (default Reverb)\n"
+            "  -a script   automation script with timestamped knob/switch/tap/gate events\n"
+            "  -b size     audio block size, 1..%d (default 48, like the firmware)\n"
+            "  -t seconds  silence appended to the input to render the tails\n"
+            "  -l dir      where the looper saves its loop and loads it from, like the\n"
+            "              SD card of the module (default: no persistence)\n"
+            "  -16         write 16 bit PCM instead of 32 bit float\n",
+            MAX_BLOCK_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *script_path = nullptr;
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+    const char *loop_dir = nullptr;
+    int initial_mode = REV;
+    size_t block_size = 48;
+    float tail_seconds = 0.f;
+    bool pcm16 = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "-m") && has_value) {
+            initial_mode = Automation::ModeIndex(argv[++i]);
+            if (initial_mode < 0) {
+                fprintf(stderr, "unknown mode %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-a") && has_value) {
+            script_path = argv[++i];
+        } else if (!strcmp(argv[i], "-b") && has_value) {
+            block_size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && has_value) {
+            tail_seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-l") && has_value) {
+            loop_dir = argv[++i];
+        } else if (!strcmp(argv[i], "-16")) {
+            pcm16 = true;
+        } else if (argv[i][0] != '-' && !in_path) {
+            in_path = argv[i];
+        } else if (argv[i][0] != '-' && !out_path) {
+            out_path = argv[i];
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (!in_path || !out_path || block_size < 1 || block_size > MAX_BLOCK_SIZE) {
+        Usage();
+        return 1;
+    }
+
+    WavFile wav;
+    if (!wav.Read(in_path)) {
+        fprintf(stderr, "can't read %s (16/24/32 bit PCM or float WAV expected)\n", in_path);
+        return 1;
+    }
+    if (wav.sample_rate != 48000) {
+        fprintf(stderr, "warning: %s is %u Hz, the effects are tuned for 48000 Hz\n", in_path, wav.sample_rate);
+    }
+    size_t tail = (size_t)(tail_seconds * wav.sample_rate);
+    wav.left.resize(wav.size() + tail, 0.f);
+    wav.right.resize(wav.size() + tail, 0.f);
+
+    Automation automation;
+    if (script_path && !automation.Load(script_path)) {
+        return 1;
+    }
+
+    HostFileSystem file_system(loop_dir ? loop_dir : ".");
+    MultiEffectInit(wav.sample_rate, &control_surface, loop_dir ? &file_system : nullptr);
+    control_surface.SelectMode(initial_mode);
+
+    WavFile output;
+    output.sample_rate = wav.sample_rate;
+    output.left.resize(wav.size());
+    output.right.resize(wav.size());
+
+    //time spent in the engine, split by the mode that was active
+    double seconds_per_mode[NUM_MODES] = {0};
+    size_t samples_per_mode[NUM_MODES] = {0};
+
+    float *in[2];
+    float *out[2];
+    for (size_t start = 0; start < wav.size(); start += block_size) {
+        size_t size = std::min(block_size, wav.size() - start);
+        automation.Apply((double)(start + size - 1) / wav.sample_rate, &control_surface);
+        //on the module these run in the main loop, the analysis of a gate is
+        //ready for the block after it
+        MultiEffectBackground();
+        MultiEffectControls();
+
+        in[0] = &wav.left[start];
+        in[1] = &wav.right[start];
+        out[0] = &output.left[start];
+        out[1] = &output.right[start];
+
+        auto begin = std::chrono::steady_clock::now();
+        MultiEffectProcess(in, out, size);
+        auto end = std::chrono::steady_clock::now();
+
+        //the mode is read by MultiEffectProcess, so this is the one that ran
+        seconds_per_mode[mode] += std::chrono::duration<double>(end - begin).count();
+        samples_per_mode[mode] += size;
+    }
+
+    if (!output.Write(out_path, pcm16)) {
+        fprintf(stderr, "can't write %s\n", out_path);
+        return 1;
+    }
+
+    printf("%-14s %10s %14s %10s\n", "mode", "seconds", "samples/s", "x realtime");
+    for (int m = 0; m < NUM_MODES; m++) {
+        if (samples_per_mode[m] == 0) {
+            continue;
+        }
+        double rate = samples_per_mode[m] / seconds_per_mode[m];
+        printf("%-14s %10.2f %14.0f %10.1f\n", modes[m],
+               (double)samples_per_mode[m] / wav.sample_rate, rate, rate / wav.sample_rate);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+//Runs the engine on the host with a generated input so the effects can be
+//profiled with perf or checked with valgrind, e.g.
+//  valgrind ./build/run_modes 1 2
+//  perf record ./build/run_modes -1 20
+//Built with PROFILE=1 it also prints the callback stage profiler stats.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "host_control_surface.h"
+#include "test_signal.h"
+#include "../engine/multi_effect.h"
+#include "../engine/profiler.h"
+
+#define SAMPLE_RATE 48000.f
+#define BLOCK_SIZE 48
+
+static HostControlSurface control_surface;
+static TestSignal test_signal;
+
+int main(int argc, char *argv[])
+{
+    //mode to run, -1 runs them all
+    int selected_mode = argc > 1 ? atoi(argv[1]) : -1;
+    float seconds = argc > 2 ? atof(argv[2]) : 5.f;
+
+    float in_l[BLOCK_SIZE], in_r[BLOCK_SIZE];
+    float out_l[BLOCK_SIZE], out_r[BLOCK_SIZE];
+    float *in[2] = {in_l, in_r};
+    float *out[2] = {out_l, out_r};
+
+    MultiEffectInit(SAMPLE_RATE, &control_surface);
+    test_signal.Init(SAMPLE_RATE);
+    for (int i = 0; i < ControlSurface::KNOB_LAST; i++) {
+        control_surface.knobs[i] = 0.5f;
+    }
+
+    size_t num_blocks = (size_t)(seconds * SAMPLE_RATE / BLOCK_SIZE);
+    for (int m = 0; m < NUM_MODES; m++) {
+        if ((selected_mode >= 0) and (m != selected_mode)) {
+            continue;
+        }
+        control_surface.SelectMode(m);
+        float peak = 0.f;
+        for (size_t b = 0; b < num_blocks; b++) {
+            //a gate every half second keeps the loopers and the analysis busy
+            if (b % (size_t)(SAMPLE_RATE / BLOCK_SIZE / 2) == 0) {
+                control_surface.TriggerGate();
+            }
+            test_signal.Render(in_l, in_r, BLOCK_SIZE);
+            MultiEffectBackground();
+            MultiEffectControls();
+            MultiEffectProcess(in, out, BLOCK_SIZE);
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                peak = fmaxf(peak, fmaxf(fabsf(out_l[i]), fabsf(out_r[i])));
+            }
+        }
+        printf("%-14s peak %.3f\n", modes[m], peak);
+    }
+#ifdef ENABLE_PROFILER
+    profiler.Dump([](const char *line) { puts(line); });
+#endif
+    return 0;
+}
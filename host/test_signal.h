@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//Deterministic stereo test input for the host tools: two detuned sines plus a
+//bit of noise, so every effect has something to chew on.
+class TestSignal {
+    float phase = 0.f;
+    float sample_rate = 48000.f;
+    uint32_t seed = 1;
+
+    public:
+    void Init(float _sample_rate) {
+        sample_rate = _sample_rate;
+        phase = 0.f;
+        seed = 1;
+    };
+
+    void Render(float *left, float *right, size_t size) {
+        const float two_pi = 2.f * (float)M_PI;
+        for (size_t i = 0; i < size; i++) {
+            seed = seed * 1664525L + 1013904223L;
+            float noise = (seed >> 8) / 16777216.f - 0.5f;
+            left[i] = 0.5f * sinf(phase) + 0.1f * noise;
+            right[i] = 0.5f * sinf(phase * 1.5f) + 0.1f * noise;
+            phase += two_pi * 220.f / sample_rate;
+            if (phase > two_pi * 2.f) {
+                //keeps both sines continuous (the right one is at 1.5x)
+                phase -= two_pi * 2.f;
+            }
+        }
+    };
+};
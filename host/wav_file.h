@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//Minimal RIFF/WAVE reader and writer for the host tools.
+//Reads 16/24/32 bit PCM and 32 bit float, mono or stereo (mono is copied to
+//both channels), writes 32 bit float or 16 bit PCM stereo.
+class WavFile {
+    public:
+    std::vector<float> left;
+    std::vector<float> right;
+    uint32_t sample_rate = 48000;
+
+    size_t size() const {
+        return left.size();
+    };
+
+    bool Read(const char *path) {
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+            return false;
+        }
+        char id[4];
+        uint32_t chunk_size;
+        if (fread(id, 1, 4, f) != 4 || memcmp(id, "RIFF", 4) != 0 ||
+            fread(&chunk_size, 4, 1, f) != 1 ||
+            fread(id, 1, 4, f) != 4 || memcmp(id, "WAVE", 4) != 0) {
+            fclose(f);
+            return false;
+        }
+        uint16_t format = 0, channels = 0, bits = 0;
+        bool have_format = false;
+        while (fread(id, 1, 4, f) == 4 && fread(&chunk_size, 4, 1, f) == 1) {
+            if (memcmp(id, "fmt ", 4) == 0) {
+                uint8_t fmt[40] = {0};
+                size_t n = chunk_size < sizeof(fmt) ? chunk_size : sizeof(fmt);
+                if (fread(fmt, 1, n, f) != n) {
+                    break;
+                }
+                fseek(f, chunk_size - n + (chunk_size & 1), SEEK_CUR);
+                memcpy(&format, &fmt[0], 2);
+                memcpy(&channels, &fmt[2], 2);
+                memcpy(&sample_rate, &fmt[4], 4);
+                memcpy(&bits, &fmt[14], 2);
+                //WAVE_FORMAT_EXTENSIBLE: the real format is in the sub format GUID
+                if (format == 0xfffe && n >= 26) {
+                    memcpy(&format, &fmt[24], 2);
+                }
+                have_format = true;
+            } else if (memcmp(id, "data", 4) == 0 && have_format) {
+                bool ok = ReadSamples(f, chunk_size, format, channels, bits);
+                fclose(f);
+                return ok;
+            } else {
+                fseek(f, chunk_size + (chunk_size & 1), SEEK_CUR);
+            }
+        }
+        fclose(f);
+        return false;
+    };
+
+    bool Write(const char *path, bool pcm16 = false) const {
+        FILE *f = fopen(path, "wb");
+        if (!f) {
+            return false;
+        }
+        uint16_t format = pcm16 ? 1 : 3;
+        uint16_t channels = 2;
+        uint16_t bits = pcm16 ? 16 : 32;
+        uint16_t block_align = channels * bits / 8;
+        uint32_t byte_rate = sample_rate * block_align;
+        uint32_t data_size = (uint32_t)(size() * block_align);
+        uint32_t fmt_size = 16;
+        uint32_t riff_size = 4 + 8 + fmt_size + 8 + data_size;
+
+        fwrite("RIFF", 1, 4, f);
+        fwrite(&riff_size, 4, 1, f);
+        fwrite("WAVE", 1, 4, f);
+        fwrite("fmt ", 1, 4, f);
+        fwrite(&fmt_size, 4, 1, f);
+        fwrite(&format, 2, 1, f);
+        fwrite(&channels, 2, 1, f);
+        fwrite(&sample_rate, 4, 1, f);
+        fwrite(&byte_rate, 4, 1, f);
+        fwrite(&block_align, 2, 1, f);
+        fwrite(&bits, 2, 1, f);
+        fwrite("data", 1, 4, f);
+        fwrite(&data_size, 4, 1, f);
+        for (size_t i = 0; i < size(); i++) {
+            if (pcm16) {
+                int16_t frame[2] = {ToPcm16(left[i]), ToPcm16(right[i])};
+                fwrite(frame, 2, 2, f);
+            } else {
+                float frame[2] = {left[i], right[i]};
+                fwrite(frame, 4, 2, f);
+            }
+        }
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    };
+
+    private:
+    static int16_t ToPcm16(float sample) {
+        sample = sample * 32767.f;
+        if (sample > 32767.f) {
+            sample = 32767.f;
+        }
+        if (sample < -32768.f) {
+            sample = -32768.f;
+        }
+        return (int16_t)sample;
+    };
+
+    bool ReadSamples(FILE *f, uint32_t data_size, uint16_t format, uint16_t channels, uint16_t bits) {
+        bool is_float = format == 3 && bits == 32;
+        bool is_pcm = format == 1 && (bits == 16 || bits == 24 || bits == 32);
+        if ((!is_float && !is_pcm) || channels == 0) {
+            return false;
+        }
+        size_t bytes = bits / 8;
+        size_t frames = data_size / (bytes * channels);
+        std::vector<uint8_t> raw(frames * bytes * channels);
+        frames = fread(raw.data(), bytes * channels, frames, f);
+        left.resize(frames);
+        right.resize(frames);
+        for (size_t i = 0; i < frames; i++) {
+            const uint8_t *frame = &raw[i * bytes * channels];
+            left[i] = Decode(frame, format, bits);
+            right[i] = channels > 1 ? Decode(frame + bytes, format, bits) : left[i];
+        }
+        return true;
+    };
+
+    static float Decode(const uint8_t *p, uint16_t format, uint16_t bits) {
+        if (format == 3) {
+            float value;
+            memcpy(&value, p, 4);
+            return value;
+        }
+        switch (bits) {
+            case 16:
+                return (int16_t)(p[0] | (p[1] << 8)) / 32768.f;
+            case 24:
+                return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) / 2147483648.f;
+            default:
+                return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24) / 2147483648.f;
+        }
+    };
+};